@@ -16,4 +16,19 @@
 
 #include <benchmark/benchmark.h>
 
-BENCHMARK_MAIN()
+#include <ufw/app/logger.hpp>
+
+#include <boost/log/expressions.hpp>
+
+int main(int argc, char** argv)
+{
+    ufw::initialize_logger();
+    SET_LOG_LEVEL(warning);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+}
@@ -0,0 +1,174 @@
+#include <benchmark/benchmark.h>
+
+#include <ufw/app/execution_context.hpp>
+#include <ufw/app/handler_memory.hpp>
+#include <ufw/app/task.hpp>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <thread>
+
+/*
+ * Every heap allocation in this executable (ufw_allocation_benchmarks) is counted, the benchmarks
+ * report the average count per iteration, zero in the steady state is the goal.
+ */
+namespace {
+std::atomic<size_t> g_allocations {0};
+} // local namespace
+
+void* operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* const p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc {};
+}
+
+// optimizing compilers see free() of what looks like a new-expression result, legitimate for a replacement pair
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+#pragma GCC diagnostic pop
+
+namespace {
+
+struct allocation_counter {
+    explicit allocation_counter(benchmark::State& state): state_ {state} {}
+
+    ~allocation_counter() {
+        state_.counters["allocs_per_op"] = benchmark::Counter(
+                double(g_allocations.load() - start_), benchmark::Counter::kAvgIterations);
+    }
+
+private:
+    benchmark::State& state_;
+    size_t const start_ {g_allocations.load()};
+};
+
+// a capture the size of a typical handler - this plus a couple of references
+struct payload {
+    void* self;
+    std::atomic<bool>* done;
+    int64_t value;
+};
+
+std::unique_ptr<ufw::execution_context> make_thread_context() {
+    ufw::execution_context_config cfg;
+    cfg.name = "worker";
+    cfg.type = "thread";
+    auto context = ufw::make_execution_context(cfg, {});
+    context->start();
+    return context;
+}
+
+void wait_for(std::atomic<bool>& done) {
+    while (!done.load(std::memory_order_acquire))
+        std::this_thread::yield();
+    done.store(false, std::memory_order_relaxed);
+}
+
+void allocation_asio_post_cross_thread_benchmark(benchmark::State& state) {
+    auto context = make_thread_context();
+    std::atomic<bool> done {false};
+    payload const p {nullptr, &done, 42};
+
+    {
+        allocation_counter counter {state};
+        for (auto _: state) {
+            boost::asio::post(context->get_executor(), [p] { p.done->store(true, std::memory_order_release); });
+            wait_for(done);
+        }
+    }
+
+    context->stop();
+}
+
+BENCHMARK(allocation_asio_post_cross_thread_benchmark);
+
+void allocation_execution_context_post_cross_thread_benchmark(benchmark::State& state) {
+    auto context = make_thread_context();
+    std::atomic<bool> done {false};
+    payload const p {nullptr, &done, 42};
+
+    {
+        allocation_counter counter {state};
+        for (auto _: state) {
+            context->post([p] { p.done->store(true, std::memory_order_release); });
+            wait_for(done);
+        }
+    }
+
+    context->stop();
+}
+
+BENCHMARK(allocation_execution_context_post_cross_thread_benchmark);
+
+// re-armed from another thread, within the context thread asio recycles the memory on its own
+template <bool Recycling>
+void timer_rearm_cross_thread(benchmark::State& state) {
+    auto context = make_thread_context();
+    boost::asio::steady_timer timer {context->get_executor()};
+    std::atomic<bool> done {false};
+    payload const p {nullptr, &done, 42};
+    auto const handler = [p](boost::system::error_code const&) { p.done->store(true, std::memory_order_release); };
+
+    {
+        allocation_counter counter {state};
+        for (auto _: state) {
+            timer.expires_after(std::chrono::seconds(0));
+            if constexpr (Recycling)
+                timer.async_wait(ufw::recycling(handler));
+            else
+                timer.async_wait(handler);
+            wait_for(done);
+        }
+    }
+
+    context->stop();
+}
+
+void allocation_timer_rearm_cross_thread_benchmark(benchmark::State& state) {
+    timer_rearm_cross_thread<false>(state);
+}
+
+BENCHMARK(allocation_timer_rearm_cross_thread_benchmark);
+
+void allocation_recycling_timer_rearm_cross_thread_benchmark(benchmark::State& state) {
+    timer_rearm_cross_thread<true>(state);
+}
+
+BENCHMARK(allocation_recycling_timer_rearm_cross_thread_benchmark);
+
+void allocation_std_function_benchmark(benchmark::State& state) {
+    payload const p {nullptr, nullptr, 42};
+
+    allocation_counter counter {state};
+    for (auto _: state) {
+        std::function<void()> f {[p] { benchmark::DoNotOptimize(p.value); }};
+        benchmark::DoNotOptimize(f);
+        f();
+    }
+}
+
+BENCHMARK(allocation_std_function_benchmark);
+
+void allocation_task_benchmark(benchmark::State& state) {
+    payload const p {nullptr, nullptr, 42};
+
+    allocation_counter counter {state};
+    for (auto _: state) {
+        ufw::task t {[p] { benchmark::DoNotOptimize(p.value); }};
+        benchmark::DoNotOptimize(t);
+        t();
+    }
+}
+
+BENCHMARK(allocation_task_benchmark);
+
+} // local namespace
@@ -0,0 +1,244 @@
+#include <benchmark/benchmark.h>
+
+#include <ufw/app/application.hpp>
+#include <ufw/app/config_cache.hpp>
+
+#include <boost/asio/post.hpp>
+#include <boost/log/sinks/sync_frontend.hpp>
+#include <boost/log/sinks/text_ostream_backend.hpp>
+#include <boost/make_shared.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+namespace {
+
+struct target: ufw::entity, ufw::lifecycle_participant
+{
+    using entity::entity;
+    int value {1};
+
+    void log_debug() const { LOG_DBG << "value " << value; }
+    void log_info() const { LOG_INF << "value " << value; }
+};
+
+// a few dozen entities, the lookups below hit one in the middle
+ufw::application& populated_application() {
+    static ufw::application* const app = [] {
+        auto* app = new ufw::application;
+        for (int i = 0; i < 64; ++i)
+            app->add<target>("entity_with_a_long_enough_name_" + std::to_string(i));
+        app->load(ufw::application_config{});
+        return app;
+    }();
+    return *app;
+}
+
+ufw::entity_id const looked_up = "entity_with_a_long_enough_name_32";
+
+void application_get_by_id_benchmark(benchmark::State& state) {
+    auto& app = populated_application();
+    for (auto _: state)
+        benchmark::DoNotOptimize(app.get<target>(looked_up).value);
+}
+
+BENCHMARK(application_get_by_id_benchmark);
+
+void application_get_by_rid_benchmark(benchmark::State& state) {
+    auto& app = populated_application();
+    auto const rid = app.resolve_entity_id(looked_up);
+    for (auto _: state)
+        benchmark::DoNotOptimize(app.get<target>(rid).value);
+}
+
+BENCHMARK(application_get_by_rid_benchmark);
+
+void application_handle_benchmark(benchmark::State& state) {
+    auto& app = populated_application();
+    auto const handle = app.handle<target>(looked_up);
+    for (auto _: state)
+        benchmark::DoNotOptimize(handle->value);
+}
+
+BENCHMARK(application_handle_benchmark);
+
+void application_entity_ref_resolve_benchmark(benchmark::State& state) {
+    auto& app = populated_application();
+    ufw::entity_ref<target> ref {looked_up, app};
+    for (auto _: state)
+    {
+        ref.resolve();
+        benchmark::DoNotOptimize(ref.get());
+    }
+}
+
+BENCHMARK(application_entity_ref_resolve_benchmark);
+
+void application_for_each_benchmark(benchmark::State& state) {
+    auto& app = populated_application();
+    for (auto _: state)
+        app.for_each<ufw::lifecycle_participant>([](ufw::lifecycle_participant& x) { benchmark::DoNotOptimize(&x); });
+}
+
+BENCHMARK(application_for_each_benchmark);
+
+// below the warning level main() sets, the cost of a disabled statement in a handler
+void application_disabled_log_benchmark(benchmark::State& state) {
+    auto const handle = populated_application().handle<target>(looked_up);
+    for (auto _: state)
+        handle->log_debug();
+}
+
+BENCHMARK(application_disabled_log_benchmark);
+
+// an enabled statement formatted into a synchronous sink writing to /dev/null
+void application_log_to_null_sink_benchmark(benchmark::State& state) {
+    namespace sinks = boost::log::sinks;
+    auto const backend = boost::make_shared<sinks::text_ostream_backend>();
+    backend->add_stream(boost::make_shared<std::ofstream>("/dev/null"));
+    auto const sink = boost::make_shared<sinks::synchronous_sink<sinks::text_ostream_backend>>(backend);
+    boost::log::core::get()->add_sink(sink);
+
+    auto const handle = populated_application().handle<target>(looked_up);
+    handle->set_log_level(boost::log::trivial::info);
+    for (auto _: state)
+        handle->log_info();
+    handle->set_log_level(boost::log::trivial::warning); // as main() sets
+
+    boost::log::core::get()->remove_sink(sink);
+}
+
+BENCHMARK(application_log_to_null_sink_benchmark);
+
+// an enabled statement with the Boost.Log core switched off - the record is not opened
+void application_log_core_disabled_benchmark(benchmark::State& state) {
+    boost::log::core::get()->set_logging_enabled(false);
+
+    auto const handle = populated_application().handle<target>(looked_up);
+    handle->set_log_level(boost::log::trivial::info);
+    for (auto _: state)
+        handle->log_info();
+    handle->set_log_level(boost::log::trivial::warning); // as main() sets
+
+    boost::log::core::get()->set_logging_enabled(true);
+}
+
+BENCHMARK(application_log_core_disabled_benchmark);
+
+/*
+ * Inbox round trip - application::post() from the benchmark thread to an entity bound to
+ * a thread context, the benchmark thread spins until the message has run.
+ */
+void application_post_round_trip_benchmark(benchmark::State& state) {
+    auto const cfg = YAML::Load(R"(
+        execution_contexts:
+          - name: worker
+            type: thread
+        entities:
+          - name: TARGET
+    )").as<ufw::application_config>();
+
+    auto entities_cfg = cfg;
+    entities_cfg.entities[0].context_ref = "worker";
+
+    ufw::application app;
+    app.register_loader("TARGET", [](ufw::config_t const&, ufw::entity_id const& id, ufw::resolved_entity_id rid, ufw::application& app)
+    {
+        return std::make_unique<target>(id, rid, app);
+    });
+    app.load(entities_cfg);
+
+    std::atomic<bool> up {false};
+    boost::asio::post(app.context(), [&] { up.store(true, std::memory_order_release); });
+    std::thread runner {[&] { app.run(); }};
+    while (!up.load(std::memory_order_acquire))
+        std::this_thread::yield();
+
+    auto& to = app.get<target>("TARGET");
+    std::atomic<bool> done {false};
+    for (auto _: state)
+    {
+        done.store(false, std::memory_order_relaxed);
+        app.post(to, [&] { done.store(true, std::memory_order_release); });
+        while (!done.load(std::memory_order_acquire))
+            ;
+    }
+
+    app.shutdown();
+    runner.join();
+}
+
+BENCHMARK(application_post_round_trip_benchmark)->UseRealTime();
+
+struct stopper: ufw::entity, ufw::lifecycle_participant
+{
+    using entity::entity;
+    void start() override { app().context().post([this] { app().shutdown(); }); }
+};
+
+// load, init, start, UP, stop and fini of an application with N lifecycle participants
+void application_startup_benchmark(benchmark::State& state) {
+    std::vector<std::string> ids;
+    for (int64_t i = 0; i < state.range(0); ++i)
+        ids.push_back("entity_" + std::to_string(i));
+
+    for (auto _: state)
+    {
+        ufw::application app;
+        for (auto const& id: ids)
+            app.add<target>(id);
+        app.add<stopper>("STOPPER");
+        app.load(ufw::application_config {});
+        app.run();
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(application_startup_benchmark)->RangeMultiplier(8)->Range(8, 512)->Unit(benchmark::kMicrosecond);
+
+// a generated topology config of N plugin entities
+std::string write_config(int64_t const n) {
+    auto const path = "/tmp/ufw-config-benchmark-" + std::to_string(n) + ".yaml";
+    std::ofstream out {path};
+    out << "application:\n  entities:\n";
+    for (int64_t i = 0; i < n; ++i)
+        out << "    - name: entity_" << i << "\n      loader_ref: PLUGIN\n      context_ref: worker\n"
+            << "      config:\n        library_ref: lib\n        constructor: entity_ctor\n"
+            << "        params: {subjects: [a." << i << ", b." << i << "], rate: 1000, hop: true}\n";
+    return path;
+}
+
+void application_config_yaml_benchmark(benchmark::State& state) {
+    auto const path = write_config(state.range(0));
+    for (auto _: state)
+    {
+        std::ifstream in {path};
+        benchmark::DoNotOptimize(YAML::Load(in)["application"].as<ufw::application_config>());
+    }
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(application_config_yaml_benchmark)->RangeMultiplier(8)->Range(8, 512)->Unit(benchmark::kMicrosecond);
+
+void application_config_cache_benchmark(benchmark::State& state) {
+    auto const path = write_config(state.range(0));
+    auto const cache_path = path + ".bin";
+    {
+        std::ifstream in {path};
+        ufw::config_cache::write(YAML::Load(in), path, cache_path);
+    }
+    for (auto _: state)
+        benchmark::DoNotOptimize((*ufw::config_cache::read(cache_path, path))["application"].as<ufw::application_config>());
+    std::remove(path.c_str());
+    std::remove(cache_path.c_str());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(application_config_cache_benchmark)->RangeMultiplier(8)->Range(8, 512)->Unit(benchmark::kMicrosecond);
+
+} // local namespace
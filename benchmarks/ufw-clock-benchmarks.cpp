@@ -0,0 +1,45 @@
+#include <benchmark/benchmark.h>
+
+#include <ufw/app/clock.hpp>
+
+#include <chrono>
+
+#include <time.h>
+
+namespace {
+
+void clock_system_clock_now_benchmark(benchmark::State& state) {
+    for (auto _: state)
+        benchmark::DoNotOptimize(std::chrono::system_clock::now());
+}
+
+BENCHMARK(clock_system_clock_now_benchmark);
+
+void clock_gettime_realtime_benchmark(benchmark::State& state) {
+    timespec ts;
+    for (auto _: state)
+    {
+        clock_gettime(CLOCK_REALTIME, &ts);
+        benchmark::DoNotOptimize(ts);
+    }
+}
+
+BENCHMARK(clock_gettime_realtime_benchmark);
+
+void clock_tsc_wall_ns_benchmark(benchmark::State& state) {
+    ufw::tsc_clock::calibrate();
+    for (auto _: state)
+        benchmark::DoNotOptimize(ufw::tsc_clock::wall_ns());
+}
+
+BENCHMARK(clock_tsc_wall_ns_benchmark);
+
+void clock_tsc_monotonic_ns_benchmark(benchmark::State& state) {
+    ufw::tsc_clock::calibrate();
+    for (auto _: state)
+        benchmark::DoNotOptimize(ufw::tsc_clock::monotonic_ns());
+}
+
+BENCHMARK(clock_tsc_monotonic_ns_benchmark);
+
+} // local namespace
@@ -0,0 +1,124 @@
+#include <benchmark/benchmark.h>
+
+#include <ufw/app/execution_context.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+/*
+ * Wake-to-handler latency - the time from post() on the benchmark thread to the
+ * handler start on the context thread, with the context idle in between.
+ */
+void wake_to_handler_latency(benchmark::State& state, ufw::execution_context_config const& cfg) {
+    auto context = ufw::make_execution_context(cfg, {});
+    context->start();
+
+    std::vector<int64_t> samples;
+    samples.reserve(1 << 20);
+
+    std::atomic<bool> done {false};
+    clock_type::time_point posted;
+    int64_t latency = 0;
+
+    for (auto _: state) {
+        done.store(false, std::memory_order_relaxed);
+        posted = clock_type::now();
+        context->post([&] {
+            latency = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - posted).count();
+            done.store(true, std::memory_order_release);
+        });
+
+        while (!done.load(std::memory_order_acquire))
+            std::this_thread::yield();
+
+        samples.push_back(latency);
+    }
+
+    context->stop();
+
+    std::sort(samples.begin(), samples.end());
+    auto const percentile = [&](double p) {
+        return double(samples[std::min(samples.size() - 1, size_t(p * samples.size()))]);
+    };
+
+    if (!samples.empty()) {
+        state.counters["p50_ns"] = percentile(0.5);
+        state.counters["p99_ns"] = percentile(0.99);
+        state.counters["p99.9_ns"] = percentile(0.999);
+        state.counters["max_ns"] = double(samples.back());
+    }
+}
+
+void execution_context_blocking_thread_latency_benchmark(benchmark::State& state) {
+    ufw::execution_context_config cfg;
+    cfg.name = "blocking";
+    cfg.type = "thread";
+    wake_to_handler_latency(state, cfg);
+}
+
+BENCHMARK(execution_context_blocking_thread_latency_benchmark)->Iterations(10000)->UseRealTime();
+
+void execution_context_busy_poll_latency_benchmark(benchmark::State& state) {
+    ufw::execution_context_config cfg;
+    cfg.name = "busy_poll";
+    cfg.type = "busy_poll";
+    wake_to_handler_latency(state, cfg);
+}
+
+BENCHMARK(execution_context_busy_poll_latency_benchmark)->Iterations(10000)->UseRealTime();
+
+/*
+ * Fan-out throughput - every iteration posts a root task spawning 64 tasks
+ * spawning 16 tasks each, all short, and waits for the last one.
+ */
+void fan_out_throughput(benchmark::State& state, std::string const& type) {
+    ufw::execution_context_config cfg;
+    cfg.name = type;
+    cfg.type = type;
+    cfg.threads = size_t(state.range(0));
+
+    auto context = ufw::make_execution_context(cfg, {});
+    context->start();
+
+    constexpr size_t fan_out = 64, leaves = 16;
+    std::atomic<size_t> pending {0};
+
+    for (auto _: state) {
+        pending.store(fan_out * leaves, std::memory_order_relaxed);
+        context->post([&] {
+            for (size_t i = 0; i < fan_out; ++i)
+                context->post([&] {
+                    for (size_t j = 0; j < leaves; ++j)
+                        context->post([&] { pending.fetch_sub(1, std::memory_order_release); });
+                });
+        });
+
+        while (pending.load(std::memory_order_acquire))
+            std::this_thread::yield();
+    }
+
+    context->stop();
+    state.SetItemsProcessed(int64_t(state.iterations() * (1 + fan_out + fan_out * leaves)));
+}
+
+void execution_context_thread_pool_fan_out_benchmark(benchmark::State& state) {
+    fan_out_throughput(state, "thread_pool");
+}
+
+BENCHMARK(execution_context_thread_pool_fan_out_benchmark)->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
+
+void execution_context_work_stealing_fan_out_benchmark(benchmark::State& state) {
+    fan_out_throughput(state, "work_stealing");
+}
+
+BENCHMARK(execution_context_work_stealing_fan_out_benchmark)->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
+
+} // local namespace
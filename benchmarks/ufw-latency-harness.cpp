@@ -0,0 +1,383 @@
+/*
+ * End-to-end round trip latency of a real application - pairs of PING and PONG entities
+ * exchanging timestamped messages over a transport:
+ *
+ *   post   - execution_context::post() to the peer context
+ *   inbox  - application::post() to the peer inbox
+ *   topics - a dispatcher publish, the subscriber hops to its own context with a post
+ *
+ * with the pair on one context thread (same), on two threads (threads) or on two threads
+ * pinned to different cores (cores).
+ *
+ * A ping sends at a fixed rate with one message in flight. The raw latency counts from the
+ * actual send, the corrected one from the scheduled send, which charges a stall to all the
+ * messages it held back (coordinated omission). Both are reported as percentiles and optionally
+ * written in the HdrHistogram percentile distribution format (.hgrm) for the HDR plotters.
+ * Back to back (rate 0) there is no schedule to correct against and only the raw one is reported.
+ *
+ *   ufw_latency --transport inbox --placement cores --pairs 2 --rate 20000 --seconds 10 --hdr inbox-cores
+ */
+
+#include <ufw/app/application.hpp>
+#include <ufw/app/clock.hpp>
+#include <ufw/app/metrics.hpp>
+#include <ufw/topics/dispatcher.hpp>
+
+#include <boost/asio/post.hpp>
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct harness_options
+{
+    std::string transport {"inbox"};
+    std::string placement {"threads"};
+    bool busy_poll {false};
+    size_t pairs {1};
+    uint64_t rate {10000}; // round trips per second per pair, 0 - back to back
+    double seconds {5};
+    uint64_t warmup {1000}; // round trips per pair not recorded
+    std::string hdr;
+};
+
+struct message
+{
+    int64_t scheduled_ns;
+    int64_t sent_ns;
+};
+
+} // local namespace
+
+UFW_TOPIC_PAYLOAD(message, "ufw_latency.message");
+
+namespace {
+
+// ufw::histogram bucket counts
+using buckets_t = std::vector<uint64_t>;
+
+struct node: ufw::entity, ufw::lifecycle_participant
+{
+    node(harness_options const& options, ufw::config_t const& cfg, ufw::entity_id const& id, ufw::resolved_entity_id rid, ufw::application& app):
+        entity {id, rid, app},
+        options_ {options},
+        peer_id_ {cfg["peer"].as<std::string>()}
+    {
+        if (options_.transport == "topics")
+        {
+            ufw::entity_ref<ufw::dispatcher> topics {"TOPICS", app};
+            topics.resolve();
+            topics_ = topics.get();
+            topics_->subscribe<message>(id, [this](message const& m)
+            {
+                context().post([this, m] { receive(m); });
+            });
+        }
+    }
+
+    void init() override
+    {
+        // not an entity_ref, which would make the pair a lifecycle dependency cycle
+        peer_ = &app().get<node>(peer_id_);
+        peer_topic_ = ufw::topic_id_for<message>(peer_id_);
+    }
+
+    virtual void receive(message const& m) = 0;
+
+protected:
+    void send(message const& m)
+    {
+        if (topics_)
+            topics_->publish(peer_topic_, m);
+        else if (options_.transport == "post")
+            peer_->context().post([peer = peer_, m] { peer->receive(m); });
+        else
+            app().post(*peer_, [peer = peer_, m] { peer->receive(m); });
+    }
+
+    harness_options const& options_;
+
+private:
+    std::string const peer_id_;
+    node* peer_ {};
+    ufw::dispatcher* topics_ {};
+    ufw::topic_id_t peer_topic_ {};
+};
+
+struct pong: node
+{
+    using node::node;
+
+    void receive(message const& m) override { send(m); }
+};
+
+struct ping: node
+{
+    ping(std::atomic<size_t>& running, harness_options const& options, ufw::config_t const& cfg, ufw::entity_id const& id,
+            ufw::resolved_entity_id rid, ufw::application& app):
+        node {options, cfg, id, rid, app},
+        running_ {running},
+        interval_ns_ {options.rate ? int64_t(1'000'000'000 / options.rate) : 0},
+        raw_(ufw::histogram::bucket_count),
+        corrected_(ufw::histogram::bucket_count)
+    {
+    }
+
+    void start() override
+    {
+        app().post(*this, [this]
+        {
+            next_ns_ = ufw::tsc_clock::monotonic_ns();
+            end_ns_ = next_ns_ + int64_t(options_.seconds * 1e9);
+            send_when_due();
+        });
+    }
+
+    void receive(message const& m) override
+    {
+        auto const now = ufw::tsc_clock::monotonic_ns();
+        if (received_++ >= options_.warmup)
+        {
+            ++raw_[ufw::histogram::bucket(uint64_t(now - m.sent_ns))];
+            if (interval_ns_)
+                ++corrected_[ufw::histogram::bucket(uint64_t(now - m.scheduled_ns))];
+        }
+
+        if (now >= end_ns_)
+        {
+            if (running_.fetch_sub(1) == 1)
+                boost::asio::post(app().context(), [this] { app().shutdown(); });
+            return;
+        }
+
+        next_ns_ = interval_ns_ ? next_ns_ + interval_ns_ : now; // back to back the next one is due right away
+        send_when_due();
+    }
+
+    buckets_t const& raw() const noexcept { return raw_; }
+    buckets_t const& corrected() const noexcept { return corrected_; }
+
+private:
+    // spins through the context queue, so that the other handlers on it keep running
+    void send_when_due()
+    {
+        auto const now = ufw::tsc_clock::monotonic_ns();
+        if (now < next_ns_)
+        {
+            context().post([this] { send_when_due(); });
+            return;
+        }
+        send({next_ns_, now});
+    }
+
+    std::atomic<size_t>& running_;
+    int64_t const interval_ns_;
+    int64_t next_ns_ {0};
+    int64_t end_ns_ {0};
+    uint64_t received_ {0};
+    buckets_t raw_;
+    buckets_t corrected_;
+};
+
+uint64_t total(buckets_t const& buckets)
+{
+    uint64_t n = 0;
+    for (auto const x: buckets)
+        n += x;
+    return n;
+}
+
+// the bucket upper bound of the value at the percentile
+uint64_t percentile(buckets_t const& buckets, double const p)
+{
+    auto const count = total(buckets);
+    if (!count)
+        return 0;
+
+    auto const rank = uint64_t(p * double(count - 1)) + 1;
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < buckets.size(); ++i)
+        if ((seen += buckets[i]) >= rank)
+            return ufw::histogram::upper_bound(i);
+    return 0;
+}
+
+// the HdrHistogram outputPercentileDistribution() layout, values in microseconds
+void write_hgrm(std::string const& path, buckets_t const& buckets)
+{
+    std::ofstream out {path, std::ios::trunc};
+    out << std::fixed << "       Value     Percentile TotalCount 1/(1-Percentile)\n\n";
+
+    auto const count = total(buckets);
+    double sum = 0, max = 0;
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < buckets.size(); ++i)
+    {
+        if (!buckets[i])
+            continue;
+
+        seen += buckets[i];
+        auto const value = double(ufw::histogram::upper_bound(i)) / 1000;
+        auto const p = double(seen) / double(count);
+        sum += value * double(buckets[i]);
+        max = value;
+
+        out << std::setw(12) << std::setprecision(3) << value << ' ' << std::setw(14) << std::setprecision(12) << p
+            << ' ' << std::setw(10) << seen;
+        if (p < 1)
+            out << ' ' << std::setw(14) << std::setprecision(2) << 1 / (1 - p);
+        out << '\n';
+    }
+
+    out << std::setprecision(3) << "#[Mean    = " << std::setw(12) << (count ? sum / double(count) : 0) << "]\n"
+        << "#[Max     = " << std::setw(12) << max << ", Total count    = " << std::setw(12) << count << "]\n";
+}
+
+void report(char const* const name, buckets_t const& buckets)
+{
+    std::cout << std::left << std::setw(10) << name << std::right;
+    for (double const p: {0.5, 0.99, 0.999, 1.0})
+        std::cout << std::setw(10) << percentile(buckets, p);
+    std::cout << '\n';
+}
+
+ufw::application_config make_config(harness_options const& options)
+{
+    if (options.transport != "post" && options.transport != "inbox" && options.transport != "topics")
+        throw ufw::fatal_error("unknown transport " + options.transport);
+    if (options.placement != "same" && options.placement != "threads" && options.placement != "cores")
+        throw ufw::fatal_error("unknown placement " + options.placement);
+
+    auto const cpus = std::max(1u, std::thread::hardware_concurrency());
+    auto const context_type = options.busy_poll ? "busy_poll" : options.placement == "cores" ? "pinned_thread" : "thread";
+
+    ufw::application_config cfg;
+
+    if (options.transport == "topics")
+        cfg.entities.push_back({"TOPICS", "TOPICS", "", {}, "", {}, {}});
+
+    for (size_t i = 0; i < options.pairs; ++i)
+    {
+        auto const ping_id = "PING" + std::to_string(i);
+        auto const pong_id = "PONG" + std::to_string(i);
+        auto const ping_context = options.placement == "same" ? "PAIR" + std::to_string(i) : ping_id;
+        auto const pong_context = options.placement == "same" ? ping_context : pong_id;
+
+        for (auto const& name: {ping_context, pong_context})
+        {
+            if (!cfg.execution_contexts.empty() && cfg.execution_contexts.back().name == name)
+                continue;
+
+            ufw::execution_context_config context;
+            context.name = name;
+            context.type = context_type;
+            if (options.placement == "cores")
+                context.cpus = {int(cfg.execution_contexts.size() % cpus)};
+            cfg.execution_contexts.push_back(context);
+        }
+
+        ufw::config_t ping_cfg, pong_cfg;
+        ping_cfg["peer"] = pong_id;
+        pong_cfg["peer"] = ping_id;
+        cfg.entities.push_back({ping_id, "PING", ping_context, {}, "", {}, ping_cfg});
+        cfg.entities.push_back({pong_id, "PONG", pong_context, {}, "", {}, pong_cfg});
+    }
+
+    return cfg;
+}
+
+} // local namespace
+
+int main(int argc, char const** argv)
+{
+    namespace po = boost::program_options;
+
+    ufw::initialize_logger();
+    SET_LOG_LEVEL(warning);
+
+    harness_options options;
+    po::options_description desc {"Options"};
+    desc.add_options()
+        ("help,h", "Print this help message")
+        ("transport", po::value(&options.transport)->default_value(options.transport), "post, inbox or topics")
+        ("placement", po::value(&options.placement)->default_value(options.placement), "same, threads or cores")
+        ("busy-poll", po::bool_switch(&options.busy_poll), "busy_poll execution contexts")
+        ("pairs", po::value(&options.pairs)->default_value(options.pairs), "ping/pong pairs")
+        ("rate", po::value(&options.rate)->default_value(options.rate), "round trips per second per pair, 0 - back to back")
+        ("seconds", po::value(&options.seconds)->default_value(options.seconds), "measurement duration")
+        ("warmup", po::value(&options.warmup)->default_value(options.warmup), "round trips per pair not recorded")
+        ("hdr", po::value(&options.hdr), "write <prefix>.raw.hgrm and <prefix>.corrected.hgrm")
+    ;
+
+    try
+    {
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        if (vm.count("help"))
+        {
+            std::cout << desc << std::endl;
+            return 0;
+        }
+        po::notify(vm);
+
+        std::atomic<size_t> running {options.pairs};
+        std::vector<ping const*> pings;
+
+        ufw::application app;
+        app.register_loader("TOPICS", [](ufw::config_t const&, ufw::entity_id const& id, ufw::resolved_entity_id rid, ufw::application& app)
+        {
+            return std::make_unique<ufw::dispatcher>(id, rid, app);
+        });
+        app.register_loader("PING", [&](ufw::config_t const& cfg, ufw::entity_id const& id, ufw::resolved_entity_id rid, ufw::application& app)
+        {
+            auto x = std::make_unique<ping>(running, options, cfg, id, rid, app);
+            pings.push_back(x.get());
+            return x;
+        });
+        app.register_loader("PONG", [&](ufw::config_t const& cfg, ufw::entity_id const& id, ufw::resolved_entity_id rid, ufw::application& app)
+        {
+            return std::make_unique<pong>(options, cfg, id, rid, app);
+        });
+
+        ufw::tsc_clock::calibrate();
+        app.load(make_config(options));
+        app.run();
+
+        buckets_t raw(ufw::histogram::bucket_count), corrected(ufw::histogram::bucket_count);
+        for (auto const* x: pings)
+        {
+            for (size_t i = 0; i < raw.size(); ++i)
+            {
+                raw[i] += x->raw()[i];
+                corrected[i] += x->corrected()[i];
+            }
+        }
+
+        std::cout << "transport " << options.transport << ", placement " << options.placement << (options.busy_poll ? " (busy poll)" : "")
+                  << ", " << options.pairs << " pair(s) at " << options.rate << "/s, " << total(raw) << " round trips\n\n"
+                  << "round trip ns    p50       p99     p99.9       max\n";
+        report("raw", raw);
+        if (options.rate)
+            report("corrected", corrected);
+
+        if (!options.hdr.empty())
+        {
+            write_hgrm(options.hdr + ".raw.hgrm", raw);
+            if (options.rate)
+                write_hgrm(options.hdr + ".corrected.hgrm", corrected);
+        }
+    }
+    catch (std::exception const& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,55 @@
+#include <benchmark/benchmark.h>
+
+#include <ufw/app/library.hpp>
+
+#include <cstdlib>
+
+namespace {
+
+// a libc function stands for a plugin one, the process has libc loaded anyway
+ufw::library_ptr const& libc() {
+#ifdef __APPLE__
+    static ufw::library_ptr const lib = ufw::library::load("/usr/lib/libSystem.B.dylib");
+#else
+    static ufw::library_ptr const lib = ufw::library::load("libc.so.6");
+#endif
+    return lib;
+}
+
+void library_function_call_benchmark(benchmark::State& state) {
+    auto const f = libc()->function<int(int)>("abs");
+    int x = -1;
+    for (auto _: state)
+        benchmark::DoNotOptimize(x = f(x));
+}
+
+BENCHMARK(library_function_call_benchmark);
+
+void library_symbol_call_benchmark(benchmark::State& state) {
+    auto const f = libc()->symbol<int(int)>("abs");
+    int x = -1;
+    for (auto _: state)
+        benchmark::DoNotOptimize(x = f(x));
+}
+
+BENCHMARK(library_symbol_call_benchmark);
+
+// the same function through a raw pointer, the baseline for the above
+void library_raw_pointer_call_benchmark(benchmark::State& state) {
+    int (*volatile const f)(int) = &::abs;
+    int x = -1;
+    for (auto _: state)
+        benchmark::DoNotOptimize(x = f(x));
+}
+
+BENCHMARK(library_raw_pointer_call_benchmark);
+
+void library_function_lookup_benchmark(benchmark::State& state) {
+    auto const& lib = libc();
+    for (auto _: state)
+        benchmark::DoNotOptimize(lib->function<int(int)>("abs"));
+}
+
+BENCHMARK(library_function_lookup_benchmark);
+
+} // local namespace
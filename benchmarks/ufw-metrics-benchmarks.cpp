@@ -0,0 +1,49 @@
+#include <benchmark/benchmark.h>
+
+#include <ufw/app/metrics.hpp>
+
+#include <atomic>
+
+namespace {
+
+ufw::metrics_registry& registry() {
+    static ufw::metrics_registry instance;
+    return instance;
+}
+
+void metrics_counter_add_benchmark(benchmark::State& state) {
+    auto const counter = registry().counter("counter");
+    for (auto _: state)
+        counter.add();
+}
+
+BENCHMARK(metrics_counter_add_benchmark)->ThreadRange(1, 4);
+
+// the baseline the shards avoid, one shared atomic counter
+void metrics_shared_atomic_add_benchmark(benchmark::State& state) {
+    static std::atomic<uint64_t> counter {0};
+    for (auto _: state)
+        counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+BENCHMARK(metrics_shared_atomic_add_benchmark)->ThreadRange(1, 4);
+
+void metrics_histogram_record_benchmark(benchmark::State& state) {
+    auto const histogram = registry().histogram("histogram");
+    uint64_t value = 0;
+    for (auto _: state)
+        histogram.record(value++ & 0xfffff);
+}
+
+BENCHMARK(metrics_histogram_record_benchmark)->ThreadRange(1, 4);
+
+void metrics_snapshot_benchmark(benchmark::State& state) {
+    registry().counter("counter").add();
+    registry().histogram("histogram").record(1);
+    for (auto _: state)
+        benchmark::DoNotOptimize(registry().snapshot());
+}
+
+BENCHMARK(metrics_snapshot_benchmark);
+
+} // local namespace
@@ -0,0 +1,55 @@
+#include <benchmark/benchmark.h>
+
+#include <ufw/topics/topics.hpp>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> const& subjects() {
+    static std::vector<std::string> const subjects = []{
+        std::vector<std::string> x;
+        for (int i = 0; i < 256; ++i)
+            x.push_back("md.equities.XLON.instrument." + std::to_string(i));
+        return x;
+    }();
+    return subjects;
+}
+
+// the interner as it was before - a std::map, made safe for threads with a mutex
+uint32_t map_resolve(std::string const& subject) {
+    static std::mutex mutex;
+    static std::map<std::string, uint32_t> interner;
+
+    std::lock_guard<std::mutex> lock {mutex};
+    return interner.try_emplace(subject, interner.size() + 1).first->second;
+}
+
+void topics_map_resolve_benchmark(benchmark::State& state) {
+    auto const& subs = subjects();
+    size_t i = state.thread_index();
+
+    for (auto _: state)
+        benchmark::DoNotOptimize(map_resolve(subs[i++ % subs.size()]));
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(topics_map_resolve_benchmark)->ThreadRange(1, 8)->UseRealTime();
+
+void topics_interner_resolve_benchmark(benchmark::State& state) {
+    auto const& subs = subjects();
+    size_t i = state.thread_index();
+
+    for (auto _: state)
+        benchmark::DoNotOptimize(ufw::topic_id_for<std::string>(subs[i++ % subs.size()]));
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(topics_interner_resolve_benchmark)->ThreadRange(1, 8)->UseRealTime();
+
+} // local namespace
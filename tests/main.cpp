@@ -16,3 +16,22 @@
 
 #define BOOST_TEST_MODULE "ufw"
 #include <boost/test/unit_test.hpp>
+
+#include <ufw/app/logger.hpp>
+
+#include <boost/log/expressions.hpp>
+
+namespace {
+
+struct logger_fixture
+{
+    logger_fixture()
+    {
+        ufw::initialize_logger();
+        SET_LOG_LEVEL(warning);
+    }
+};
+
+BOOST_TEST_GLOBAL_FIXTURE(logger_fixture);
+
+} // local namespace
@@ -16,6 +16,42 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <ufw/app/application.hpp>
+#include <ufw/app/clock.hpp>
+#include <ufw/app/config_cache.hpp>
+#include <ufw/app/inbox.hpp>
+#include <ufw/app/library.hpp>
+#include <ufw/app/library_repository.hpp>
+#include <ufw/app/plugin_repository.hpp>
+#include <ufw/app/static_plugins.hpp>
+#include <ufw/app/metrics.hpp>
+#include <ufw/app/task.hpp>
+#include <ufw/app/trace.hpp>
+#include <ufw/app/work_stealing_pool.hpp>
+
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/log/expressions.hpp>
+#include <boost/log/sinks/sync_frontend.hpp>
+#include <boost/log/sinks/text_ostream_backend.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
 namespace {
 
 BOOST_AUTO_TEST_SUITE(ufw_app)
@@ -24,6 +60,1058 @@ BOOST_AUTO_TEST_CASE(placeholder_test) {
     BOOST_TEST_MESSAGE("hello world");
 } // BOOST_AUTO_TEST_CASE(placeholder_test)
 
+BOOST_AUTO_TEST_CASE(ring_test) {
+    for (bool const single_producer: {true, false})
+    {
+        int const producers = single_producer ? 1 : 4;
+        int const per_producer = 20000;
+
+        ufw::ring<int> r {256, single_producer};
+
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; ++p)
+            threads.emplace_back([&r, p]
+            {
+                for (int i = 0; i < per_producer; ++i)
+                    while (!r.try_push(p * per_producer + i))
+                        std::this_thread::yield();
+            });
+
+        std::vector<int> last(producers, -1);
+        int received = 0;
+        bool ordered = true;
+        while (received < producers * per_producer)
+        {
+            received += r.drain([&](int x)
+            {
+                auto& l = last[x / per_producer];
+                ordered = ordered && l < x % per_producer;
+                l = x % per_producer;
+            }, 64);
+        }
+
+        for (auto& t: threads)
+            t.join();
+
+        BOOST_REQUIRE(ordered);
+        BOOST_REQUIRE(r.empty());
+    }
+} // BOOST_AUTO_TEST_CASE(ring_test)
+
+/**
+ * The records written while alive, as Entity|Tag|Line|message lines. The sink is one for all the
+ * tests: Boost.Log keeps the formatting state of a thread by the sink address, and a sink added
+ * after another removed may get the same address and the stale formatter on the binary log
+ * backend thread.
+ */
+struct captured_log
+{
+    using sink_t = boost::log::sinks::synchronous_sink<boost::log::sinks::text_ostream_backend>;
+
+    captured_log()
+    {
+        sink().locked_backend()->add_stream(out_);
+        boost::log::core::get()->add_sink(sink_);
+    }
+
+    ~captured_log()
+    {
+        ufw::binary_log::flush();
+        boost::log::core::get()->remove_sink(sink_);
+        sink().locked_backend()->remove_stream(out_);
+    }
+
+    std::vector<std::string> lines() const
+    {
+        ufw::binary_log::flush();
+        std::vector<std::string> lines;
+        std::istringstream in {out_->str()};
+        for (std::string line; std::getline(in, line);)
+            lines.push_back(line);
+        return lines;
+    }
+
+    // the messages of the lines
+    std::vector<std::string> messages() const
+    {
+        auto lines = this->lines();
+        for (auto& line: lines)
+            for (int i = 0; i < 3; ++i)
+                line.erase(0, line.find('|') + 1);
+        return lines;
+    }
+
+private:
+    static sink_t& sink()
+    {
+        namespace expr = boost::log::expressions;
+        static boost::shared_ptr<sink_t> const instance = []
+        {
+            auto const sink = boost::make_shared<sink_t>();
+            sink->set_formatter(expr::stream << expr::attr<std::string>("Entity") << "|" << expr::attr<std::string>("Tag")
+                    << "|" << expr::attr<int>("Line") << "|" << expr::smessage);
+            return sink;
+        }();
+        return *instance;
+    }
+
+    boost::shared_ptr<sink_t> const sink_ {&sink(), [](sink_t*) {}};
+    boost::shared_ptr<std::ostringstream> const out_ {boost::make_shared<std::ostringstream>()};
+};
+
+BOOST_AUTO_TEST_CASE(binary_logger_test) {
+    captured_log const log;
+
+    static constexpr ufw::binary_log::site s {__FILE__, 42, __func__, "TAG", boost::log::trivial::error};
+    ufw::log_source const source {ufw::intern_log_name("TESTER")};
+
+    ufw::binary_log::record_writer {source, s} << "n=" << 7 << " u=" << 8u << " b=" << true << " c=" << 'x';
+    ufw::binary_log::record_writer {source, s} << "pi=" << std::fixed << std::setprecision(2) << 3.14159 << " s=" << std::string {"str"};
+    std::thread {[&] { ufw::binary_log::record_writer {source, s} << std::string(2000, 'z'); }}.join();
+
+    auto const lines = log.lines();
+    BOOST_REQUIRE_EQUAL(lines.size(), 3u);
+    BOOST_REQUIRE_EQUAL(lines[0], "TESTER|TAG|42|n=7 u=8 b=true c=x");
+    BOOST_REQUIRE_EQUAL(lines[1], "TESTER|TAG|42|pi=3.14 s=str");
+    BOOST_REQUIRE(lines[2].size() < 1100 && lines[2].ends_with("zz..."));
+    BOOST_REQUIRE_EQUAL(ufw::binary_log::dropped(), 0u);
+} // BOOST_AUTO_TEST_CASE(binary_logger_test)
+
+BOOST_AUTO_TEST_CASE(log_limiter_test) {
+    ufw::flush_suppressed_logs(); // the ones of the other tests
+    captured_log const log;
+
+    int every_n = 0, first_n = 0, rate_limited = 0;
+    auto const log_first_n = [&] { LOG_ERR_FIRST_N(2) << "first_n " << ++first_n; };
+    auto const log_rate_limited = [&](char const* what) { LOG_ERR_RATE_LIMITED(10, 3) << what << ++rate_limited; };
+
+    for (int i = 0; i < 10; ++i)
+    {
+        LOG_ERR_EVERY_N(3) << "every_n " << ++every_n;
+        log_first_n();
+        log_rate_limited("in the burst ");
+        LOG_DBG_EVERY_N(1) << "below the level " << ++every_n;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    log_rate_limited("after the burst ");
+
+    // a flood that stops, the count is flushed with no record after it
+    for (int i = 0; i < 5; ++i)
+        LOG_ERR_RATE_LIMITED(1, 1) << "flood " << ++rate_limited;
+    auto const flushed = ufw::flush_suppressed_logs();
+
+    // the first n count is flushed once
+    log_first_n();
+    auto const flushed_again = ufw::flush_suppressed_logs();
+
+    // zero limits taken for one
+    int zeros = 0;
+    for (int i = 0; i < 3; ++i)
+    {
+        LOG_ERR_EVERY_N(0) << "every 0 " << ++zeros;
+        LOG_ERR_RATE_LIMITED(0, 0) << "rate 0 " << ++zeros;
+    }
+    ufw::flush_suppressed_logs();
+
+    BOOST_REQUIRE_EQUAL(every_n, 4);
+    BOOST_REQUIRE_EQUAL(first_n, 2);
+    BOOST_REQUIRE_EQUAL(rate_limited, 5);
+    BOOST_REQUIRE_EQUAL(flushed, 2u);
+    BOOST_REQUIRE_EQUAL(flushed_again, 0u);
+    BOOST_REQUIRE_EQUAL(zeros, 4);
+
+    auto const messages = log.messages();
+    std::vector<std::string> const expected {"[7 suppressed] after the burst 4", "flood 5", "[8 suppressed]", "[4 suppressed]",
+            "every 0 1", "rate 0 2", "every 0 3", "every 0 4", "[2 suppressed]"};
+    BOOST_REQUIRE_GE(messages.size(), expected.size());
+    BOOST_REQUIRE(std::equal(expected.begin(), expected.end(), messages.end() - expected.size()));
+} // BOOST_AUTO_TEST_CASE(log_limiter_test)
+
+BOOST_AUTO_TEST_CASE(tsc_clock_test) {
+    auto const system_ns = []
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    };
+    int64_t const tolerance_ns = 1'000'000;
+
+    // clock_gettime() until calibrated
+    BOOST_REQUIRE_LT(std::abs(ufw::tsc_clock::wall_ns() - system_ns()), tolerance_ns);
+
+    if (!ufw::tsc_clock::calibrate())
+        return;
+
+    BOOST_REQUIRE(ufw::tsc_clock::calibrated());
+    BOOST_REQUIRE_GT(ufw::tsc_clock::frequency_ghz(), 0.1);
+
+    auto last = ufw::tsc_clock::monotonic_ns();
+    for (int i = 0; i < 100000; ++i)
+    {
+        if (i % 10000 == 0)
+            ufw::tsc_clock::resync();
+        auto const now = ufw::tsc_clock::monotonic_ns();
+        BOOST_REQUIRE_GE(now, last);
+        last = now;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ufw::tsc_clock::resync();
+    BOOST_REQUIRE_LT(std::abs(ufw::tsc_clock::wall_ns() - system_ns()), tolerance_ns);
+} // BOOST_AUTO_TEST_CASE(tsc_clock_test)
+
+BOOST_AUTO_TEST_CASE(task_test) {
+    auto const alive = std::make_shared<int>(0);
+
+    size_t calls = 0;
+    ufw::task small {[&calls, alive] { ++calls; }};
+    ufw::task large {[&calls, alive, padding = std::array<char, 2 * ufw::task::inline_size> {}] { calls += 1 + padding[0]; }};
+    BOOST_REQUIRE_EQUAL(alive.use_count(), 3);
+
+    ufw::task moved {std::move(small)};
+    BOOST_REQUIRE(!small);
+    moved();
+    large = std::move(moved);
+    BOOST_REQUIRE_EQUAL(alive.use_count(), 2); // the large one is destroyed by the assignment
+    large();
+    BOOST_REQUIRE_EQUAL(calls, 2u);
+
+    large = ufw::task {};
+    BOOST_REQUIRE_EQUAL(alive.use_count(), 1);
+
+    // a block freed on another thread comes back to the allocating one, on a fresh thread for an empty local list
+    void* p = nullptr;
+    void* q = nullptr;
+    std::thread {[&p, &q]
+    {
+        p = ufw::handler_memory::allocate(100);
+        std::thread {[p] { ufw::handler_memory::deallocate(p, 100); }}.join();
+        q = ufw::handler_memory::allocate(100);
+        ufw::handler_memory::deallocate(q, 100);
+    }}.join();
+    BOOST_REQUIRE_EQUAL(p, q);
+} // BOOST_AUTO_TEST_CASE(task_test)
+
+struct ponger: ufw::entity, ufw::lifecycle_participant
+{
+    using entity::entity;
+
+    void start() override
+    {
+        for (int i = 0; i < 1000; ++i)
+            app().post(*this, [this, i]
+            {
+                received.push_back(i);
+                if (i == 999) app().shutdown();
+            });
+    }
+
+    std::vector<int> received;
+};
+
+BOOST_AUTO_TEST_CASE(inbox_post_test) {
+    ufw::application app;
+    app.add<ponger>("PONG");
+    app.load(ufw::application_config{});
+    app.run();
+
+    auto const& received = app.get<ponger>("PONG").received;
+    BOOST_REQUIRE_EQUAL(received.size(), 1000u);
+    for (int i = 0; i < 1000; ++i)
+        BOOST_REQUIRE_EQUAL(received[i], i);
+} // BOOST_AUTO_TEST_CASE(inbox_post_test)
+
+struct worker: ufw::entity, ufw::lifecycle_participant
+{
+    using entity::entity;
+
+    void start() override
+    {
+        context().post([this]
+        {
+            worker_thread = std::this_thread::get_id();
+            app().post(*this, [this]
+            {
+                inbox_thread = std::this_thread::get_id();
+                app().context().post([this] { app().shutdown(); });
+            });
+        });
+    }
+
+    std::thread::id worker_thread;
+    std::thread::id inbox_thread;
+};
+
+BOOST_AUTO_TEST_CASE(execution_context_test) {
+    auto const cfg = YAML::Load(R"(
+        execution_contexts:
+          - name: pool
+            type: thread_pool
+            threads: 2
+          - name: serial
+            type: strand
+            context_ref: pool
+        entities:
+          - name: WORKER
+            context_ref: serial
+    )").as<ufw::application_config>();
+
+    BOOST_REQUIRE_EQUAL(cfg.execution_contexts.size(), 2u);
+    BOOST_REQUIRE_EQUAL(cfg.execution_contexts[0].threads, 2u);
+    BOOST_REQUIRE_EQUAL(cfg.entities[0].context_ref, "serial");
+
+    ufw::application app;
+    app.register_loader("WORKER", [](ufw::config_t const&, ufw::entity_id const& id, ufw::resolved_entity_id rid, ufw::application& app)
+    {
+        return std::make_unique<worker>(id, rid, app);
+    });
+    app.load(cfg);
+
+    auto& w = app.get<worker>("WORKER");
+    BOOST_REQUIRE_EQUAL(w.context().name(), "serial");
+
+    app.run();
+
+    BOOST_REQUIRE(w.worker_thread != std::thread::id());
+    BOOST_REQUIRE(w.worker_thread != std::this_thread::get_id());
+    BOOST_REQUIRE(w.inbox_thread != std::this_thread::get_id());
+} // BOOST_AUTO_TEST_CASE(execution_context_test)
+
+BOOST_AUTO_TEST_CASE(entity_index_test) {
+    ufw::application app;
+    app.add<ponger>("PONG");
+    app.add<ufw::entity>("PLAIN");
+    BOOST_REQUIRE_THROW(app.add<ufw::entity>("PLAIN"), ufw::fatal_error);
+    BOOST_REQUIRE_THROW(app.all<ponger>(), ufw::fatal_error);
+
+    app.load(ufw::application_config{});
+
+    auto const pong = app.handle<ponger>("PONG");
+    BOOST_REQUIRE(pong);
+    BOOST_REQUIRE_EQUAL(pong.get(), &app.get<ponger>("PONG"));
+    BOOST_REQUIRE_EQUAL(pong.resolved_id(), app.resolve_entity_id("PONG"));
+    BOOST_REQUIRE_THROW(app.handle<ponger>("PLAIN"), ufw::fatal_error);
+    BOOST_REQUIRE_THROW(app.handle<ponger>("NOBODY"), ufw::fatal_error);
+
+    auto const& pongers = app.all<ponger>();
+    BOOST_REQUIRE_EQUAL(pongers.size(), 1u);
+    BOOST_REQUIRE_EQUAL(pongers[0], pong.get());
+    BOOST_REQUIRE_EQUAL(&app.all<ponger>(), &pongers);
+
+    size_t participants = 0;
+    app.for_each<ufw::lifecycle_participant>([&](ufw::lifecycle_participant&) { ++participants; });
+    BOOST_REQUIRE_EQUAL(participants, 1u);
+    BOOST_REQUIRE_GE(app.all<ufw::entity>().size(), 3u); // with the default loader
+} // BOOST_AUTO_TEST_CASE(entity_index_test)
+
+struct log_counter: ufw::entity
+{
+    using entity::entity;
+
+    void log(int& evaluated) const { LOG_DBG << "evaluated " << ++evaluated; }
+};
+
+BOOST_AUTO_TEST_CASE(entity_log_level_test) {
+    auto const cfg = YAML::Load(R"(
+        entities:
+          - name: QUIET
+            loader_ref: COUNTER
+          - name: LOUD
+            loader_ref: COUNTER
+            log_level: debug
+    )").as<ufw::application_config>();
+
+    auto const loader = [](ufw::config_t const&, ufw::entity_id const& id, ufw::resolved_entity_id rid, ufw::application& app)
+    {
+        return std::make_unique<log_counter>(id, rid, app);
+    };
+
+    ufw::application app;
+    app.register_loader("COUNTER", loader);
+    app.load(cfg);
+
+    int evaluated = 0;
+    app.get<log_counter>("QUIET").log(evaluated); // below the global warning level, the arguments are not evaluated
+    BOOST_REQUIRE_EQUAL(evaluated, 0);
+    app.get<log_counter>("LOUD").log(evaluated);
+    BOOST_REQUIRE_EQUAL(evaluated, LOG_COMPILED_OUT(debug) ? 0 : 1);
+
+    auto bad_cfg = cfg;
+    bad_cfg.entities[0].log_level = "chatty";
+    ufw::application bad_app;
+    bad_app.register_loader("COUNTER", loader);
+    BOOST_REQUIRE_THROW(bad_app.load(bad_cfg), ufw::fatal_error);
+} // BOOST_AUTO_TEST_CASE(entity_log_level_test)
+
+struct lifecycle_log
+{
+    void add(std::string x)
+    {
+        std::lock_guard<std::mutex> lock {mutex};
+        entries.push_back(std::move(x));
+    }
+
+    ptrdiff_t index(std::string const& x) const
+    {
+        return std::find(entries.begin(), entries.end(), x) - entries.begin();
+    }
+
+    std::mutex mutex;
+    std::vector<std::string> entries;
+};
+
+struct stage_recorder: ufw::entity, ufw::lifecycle_participant
+{
+    stage_recorder(lifecycle_log& log, ufw::config_t const& cfg, ufw::entity_id const& id, ufw::resolved_entity_id rid, ufw::application& app):
+        entity {id, rid, app},
+        log_ {log},
+        peer_ {cfg["peer"] ? cfg["peer"].as<std::string>() : std::string {"LEAF"}, app} {}
+
+    void init() override { log_.add("init " + id()); }
+    void start() override
+    {
+        log_.add("start " + id());
+        if (id() == "ROOT")
+            app().context().post([this] { app().shutdown(); });
+    }
+    void stop() noexcept override { log_.add("stop " + id()); }
+    void fini() noexcept override { log_.add("fini " + id()); }
+
+private:
+    lifecycle_log& log_;
+    ufw::entity_ref<ufw::entity> peer_;
+};
+
+BOOST_AUTO_TEST_CASE(lifecycle_dependencies_test) {
+    // declared in the reverse dependency order: ROOT depends on MID by depends_on, MID on LEAF by an entity_ref
+    auto const cfg = YAML::Load(R"(
+        bootstrap_threads: 4
+        entities:
+          - name: ROOT
+            loader_ref: RECORDER
+            depends_on: [MID]
+          - name: MID
+            loader_ref: RECORDER
+          - name: OTHER
+            loader_ref: RECORDER
+            config:
+              peer: ROOT
+          - name: LEAF
+            loader_ref: RECORDER
+            config:
+              peer: NOBODY
+    )").as<ufw::application_config>();
+
+    BOOST_REQUIRE_EQUAL(cfg.bootstrap_threads, 4u);
+    BOOST_REQUIRE_EQUAL(cfg.entities[0].depends_on.size(), 1u);
+
+    lifecycle_log log;
+    ufw::application app;
+    app.register_loader("RECORDER", [&log](ufw::config_t const& cfg, ufw::entity_id const& id, ufw::resolved_entity_id rid, ufw::application& app)
+    {
+        return std::make_unique<stage_recorder>(log, cfg, id, rid, app);
+    });
+    app.load(cfg);
+    app.run();
+
+    BOOST_REQUIRE_EQUAL(log.entries.size(), 16u);
+    for (auto stage: {"init ", "start "})
+    {
+        BOOST_REQUIRE_LT(log.index(stage + std::string {"LEAF"}), log.index(stage + std::string {"MID"}));
+        BOOST_REQUIRE_LT(log.index(stage + std::string {"MID"}), log.index(stage + std::string {"ROOT"}));
+        BOOST_REQUIRE_LT(log.index(stage + std::string {"ROOT"}), log.index(stage + std::string {"OTHER"}));
+    }
+    for (auto stage: {"stop ", "fini "})
+    {
+        BOOST_REQUIRE_LT(log.index(stage + std::string {"OTHER"}), log.index(stage + std::string {"ROOT"}));
+        BOOST_REQUIRE_LT(log.index(stage + std::string {"ROOT"}), log.index(stage + std::string {"MID"}));
+        BOOST_REQUIRE_LT(log.index(stage + std::string {"MID"}), log.index(stage + std::string {"LEAF"}));
+    }
+} // BOOST_AUTO_TEST_CASE(lifecycle_dependencies_test)
+
+BOOST_AUTO_TEST_CASE(lifecycle_dependency_cycle_test) {
+    auto const cfg = YAML::Load(R"(
+        entities:
+          - name: A
+            loader_ref: RECORDER
+            depends_on: [B]
+          - name: B
+            loader_ref: RECORDER
+            config:
+              peer: A
+    )").as<ufw::application_config>();
+
+    lifecycle_log log;
+    ufw::application app;
+    app.register_loader("RECORDER", [&log](ufw::config_t const& cfg, ufw::entity_id const& id, ufw::resolved_entity_id rid, ufw::application& app)
+    {
+        return std::make_unique<stage_recorder>(log, cfg, id, rid, app);
+    });
+    BOOST_REQUIRE_THROW(app.load(cfg), ufw::fatal_error);
+} // BOOST_AUTO_TEST_CASE(lifecycle_dependency_cycle_test)
+
+BOOST_AUTO_TEST_CASE(work_stealing_pool_test) {
+    ufw::work_stealing_pool pool {4, {}, {}, 64}; // small deques to exercise the overflow path
+    pool.start();
+
+    constexpr size_t fan_out = 100, depth = 2;
+    std::atomic<size_t> done {0};
+
+    std::function<void(size_t)> spawn = [&](size_t const level) {
+        if (level == depth)
+        {
+            done.fetch_add(1);
+            return;
+        }
+        for (size_t i = 0; i < fan_out; ++i)
+            boost::asio::post(pool.get_executor(), [&, level] { spawn(level + 1); });
+    };
+    boost::asio::post(pool.get_executor(), [&] { spawn(0); });
+
+    // a burst from outside the pool, past the capacity of the inboxes
+    std::atomic<size_t> injected {0};
+    for (size_t i = 0; i < 1000; ++i)
+        boost::asio::post(pool.get_executor(), [&] { injected.fetch_add(1); });
+
+    // timers and strands over the type-erased executor
+    boost::asio::any_io_executor const ex = pool.get_executor();
+    std::atomic<bool> fired {false};
+    boost::asio::steady_timer timer {ex, std::chrono::milliseconds(1)};
+    timer.async_wait([&](boost::system::error_code const& ec) { fired = !ec; });
+
+    auto strand = boost::asio::make_strand(ex);
+    size_t serial = 0; // guarded by the strand
+    std::atomic<size_t> strand_done {0};
+    for (size_t i = 0; i < 1000; ++i)
+        boost::asio::post(strand, [&] { ++serial; strand_done.fetch_add(1); });
+
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while ((done < fan_out * fan_out || injected < 1000 || !fired || strand_done < 1000) && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    pool.stop();
+
+    BOOST_REQUIRE_EQUAL(done.load(), fan_out * fan_out);
+    BOOST_REQUIRE_EQUAL(injected.load(), 1000u);
+    BOOST_REQUIRE(fired);
+    BOOST_REQUIRE_EQUAL(serial, 1000u);
+} // BOOST_AUTO_TEST_CASE(work_stealing_pool_test)
+
+BOOST_AUTO_TEST_CASE(metrics_test) {
+    for (uint64_t v = 1; v < (uint64_t {1} << 20); v += v / 7 + 1)
+    {
+        auto const b = ufw::histogram::bucket(v);
+        BOOST_REQUIRE_LE(v, ufw::histogram::upper_bound(b));
+        BOOST_REQUIRE_GT(v, ufw::histogram::upper_bound(b - 1));
+    }
+
+    ufw::metrics_registry registry;
+    auto const events = registry.counter("events");
+    auto const latency = registry.histogram("latency");
+    registry.gauge("depth").set(-3);
+    BOOST_REQUIRE_THROW(registry.gauge("events"), ufw::fatal_error);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back([&]
+        {
+            for (uint64_t i = 1; i <= 1000; ++i)
+            {
+                registry.counter("events").add();
+                latency.record(i);
+            }
+        });
+    for (auto& t: threads)
+        t.join();
+    BOOST_REQUIRE_EQUAL(registry.shards(), 0u); // folded into the retired total on the thread exit
+    events.add(2);
+
+    auto const snapshot = registry.snapshot();
+    BOOST_REQUIRE_EQUAL(snapshot.counters.at(0).second, 4002u);
+    BOOST_REQUIRE_EQUAL(snapshot.gauges.at(0).second, -3);
+
+    auto const& h = snapshot.histograms.at(0);
+    BOOST_REQUIRE_EQUAL(h.count, 4000u);
+    BOOST_REQUIRE_CLOSE(h.mean, 500.5, 0.01);
+    BOOST_REQUIRE(h.p50 >= 500 && h.p50 <= 500 + 500 / 16);
+    BOOST_REQUIRE(h.max >= 1000 && h.max <= 1000 + 1000 / 16);
+
+    std::ostringstream json;
+    snapshot.write_json(json);
+    BOOST_REQUIRE(json.str().find("\"events\":4002") != std::string::npos);
+
+    // the entity metrics are named after the entity, the METRICS entity dumps them at stop()
+    auto const path = "/tmp/ufw-metrics-test-" + std::to_string(getpid()) + ".json";
+    auto const cfg = YAML::Load(R"(
+        entities:
+          - name: STATS
+            loader_ref: METRICS
+            config:
+              interval_ms: 5
+          - name: ROOT
+            loader_ref: RECORDER
+    )").as<ufw::application_config>();
+
+    auto app_cfg = cfg;
+    app_cfg.entities[0].config["path"] = path;
+
+    lifecycle_log log;
+    ufw::application app;
+    app.register_loader("RECORDER", [&log](ufw::config_t const& cfg, ufw::entity_id const& id, ufw::resolved_entity_id rid, ufw::application& app)
+    {
+        return std::make_unique<stage_recorder>(log, cfg, id, rid, app);
+    });
+    app.load(app_cfg);
+    app.get<ufw::entity>("ROOT").make_counter("runs").add();
+    app.run();
+
+    std::ifstream in {path};
+    std::string const dumped {std::istreambuf_iterator<char> {in}, std::istreambuf_iterator<char> {}};
+    std::remove(path.c_str());
+    BOOST_REQUIRE(dumped.find("\"ROOT.runs\":1") != std::string::npos);
+
+    // a thread alternating between registries keeps one shard in each
+    ufw::metrics_registry other;
+    auto* const shard = &registry.local_shard();
+    for (int i = 0; i < 3; ++i)
+    {
+        other.counter("events").add();
+        BOOST_REQUIRE_EQUAL(&registry.local_shard(), shard);
+    }
+} // BOOST_AUTO_TEST_CASE(metrics_test)
+
+struct sleeper: ufw::entity, ufw::lifecycle_participant
+{
+    using entity::entity;
+
+    void start() override
+    {
+        app().post(*this, [this]
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            app().context().post([this] { app().shutdown(); });
+        });
+    }
+};
+
+BOOST_AUTO_TEST_CASE(handler_instrumentation_test) {
+    auto const cfg = YAML::Load(R"(
+        instrument_handlers: true
+        handler_budget_us: 1000
+        execution_contexts:
+          - name: pool
+            type: thread_pool
+            threads: 1
+        entities:
+          - name: SLEEPER
+            context_ref: pool
+    )").as<ufw::application_config>();
+
+    ufw::application app;
+    app.register_loader("SLEEPER", [](ufw::config_t const&, ufw::entity_id const& id, ufw::resolved_entity_id rid, ufw::application& app)
+    {
+        return std::make_unique<sleeper>(id, rid, app);
+    });
+    app.load(cfg);
+    app.run();
+
+    auto const snapshot = app.metrics().snapshot();
+    auto const histogram = [&](std::string const& name)
+    {
+        for (auto const& h: snapshot.histograms)
+            if (h.name == name)
+                return h;
+        BOOST_FAIL("no histogram " + name);
+        return snapshot.histograms.front();
+    };
+
+    // up() and the message, both run in the inbox drains posted to the pool
+    BOOST_REQUIRE_EQUAL(histogram("SLEEPER.execution_ns").count, 2u);
+    BOOST_REQUIRE_GE(histogram("SLEEPER.execution_ns").max, 5'000'000u);
+    BOOST_REQUIRE_GE(histogram("pool.execution_ns").count, 1u);
+
+    auto const slowest = app.handlers().slowest();
+    BOOST_REQUIRE(!slowest.empty());
+    BOOST_REQUIRE_GE(slowest.front().execution_ns, 5'000'000);
+} // BOOST_AUTO_TEST_CASE(handler_instrumentation_test)
+
+BOOST_AUTO_TEST_CASE(handler_watchdog_test) {
+    auto const cfg = YAML::Load(R"(
+        instrument_handlers: true
+        handler_budget_us: 1000
+        execution_contexts:
+          - name: pool
+            type: thread_pool
+            threads: 1
+        entities:
+          - name: SLEEPER
+            context_ref: pool
+    )").as<ufw::application_config>();
+
+    captured_log const log;
+    {
+        ufw::application app;
+        app.register_loader("SLEEPER", [](ufw::config_t const&, ufw::entity_id const& id, ufw::resolved_entity_id rid, ufw::application& app)
+        {
+            return std::make_unique<sleeper>(id, rid, app);
+        });
+        app.load(cfg);
+        app.run();
+    }
+
+    // the sleeping handler, caught running by the watchdog, is not reported again when over
+    auto const messages = log.messages();
+    auto const reports = std::count_if(messages.begin(), messages.end(), [](std::string const& x)
+    {
+        return x.find("watchdog: ") != std::string::npos && x.find(" in SLEEPER ") != std::string::npos;
+    });
+    BOOST_REQUIRE_EQUAL(reports, 1);
+} // BOOST_AUTO_TEST_CASE(handler_watchdog_test)
+
+BOOST_AUTO_TEST_CASE(trace_test) {
+    ufw::tracer::enable(true);
+    {
+        ufw::trace_scope const outer {"outer", "X"};
+        std::thread {[] { ufw::trace_scope const inner {typeid(std::string).name(), nullptr, true}; }}.join();
+    }
+    ufw::tracer::enable(false);
+    ufw::trace_scope const ignored {"ignored"};
+
+    std::ostringstream events;
+    BOOST_REQUIRE_EQUAL(ufw::tracer::flush(events, true), 4u);
+    BOOST_REQUIRE_EQUAL(ufw::tracer::flush(events, false), 0u);
+
+    auto const json = events.str();
+    BOOST_REQUIRE_EQUAL(json.find("{\"name\":\"outer X\",\"cat\":\"ufw\",\"ph\":\"B\""), 0u);
+    BOOST_REQUIRE(json.find("\"name\":\"std::") != std::string::npos);
+    BOOST_REQUIRE(json.find("ignored") == std::string::npos);
+
+    // a scope open across the disable records no end event
+    {
+        ufw::tracer::enable(true);
+        ufw::trace_scope const open {"open"};
+        ufw::tracer::enable(false);
+    }
+    BOOST_REQUIRE_EQUAL(ufw::tracer::flush(events, false), 1u);
+
+    // the events left of a past recording are not flushed with the next one
+    ufw::tracer::enable(true);
+    ufw::tracer::record('B', "past", nullptr, false);
+    ufw::tracer::enable(false);
+    ufw::tracer::enable(true);
+    ufw::tracer::enable(false);
+    BOOST_REQUIRE_EQUAL(ufw::tracer::flush(events, false), 0u);
+
+    // the TRACE entity writes a JSON array, with the framework events if built with UFW_TRACE
+    auto const path = "/tmp/ufw-trace-test-" + std::to_string(getpid()) + ".json";
+    auto cfg = YAML::Load(R"(
+        entities:
+          - name: TRACE
+            loader_ref: TRACE
+          - name: ROOT
+            loader_ref: RECORDER
+    )").as<ufw::application_config>();
+    cfg.entities[0].config["path"] = path;
+
+    lifecycle_log log;
+    ufw::application app;
+    app.register_loader("RECORDER", [&log](ufw::config_t const& cfg, ufw::entity_id const& id, ufw::resolved_entity_id rid, ufw::application& app)
+    {
+        return std::make_unique<stage_recorder>(log, cfg, id, rid, app);
+    });
+    app.load(cfg);
+    app.run();
+    BOOST_REQUIRE(!ufw::tracer::enabled());
+
+    std::ifstream in {path};
+    std::string const traced {std::istreambuf_iterator<char> {in}, std::istreambuf_iterator<char> {}};
+    std::remove(path.c_str());
+    BOOST_REQUIRE_EQUAL(traced.front(), '[');
+    BOOST_REQUIRE_EQUAL(traced.substr(traced.size() - 2), "]\n");
+#ifdef UFW_TRACE
+    BOOST_REQUIRE(traced.find("\"name\":\"load ROOT\"") != std::string::npos);
+    BOOST_REQUIRE(traced.find("\"name\":\"fini ROOT\",\"cat\":\"ufw\",\"ph\":\"E\"") != std::string::npos);
+#endif
+} // BOOST_AUTO_TEST_CASE(trace_test)
+
+BOOST_AUTO_TEST_CASE(startup_profile_test) {
+    auto const base = "/tmp/ufw-startup-test-" + std::to_string(getpid());
+    auto const config_path = base + ".yaml";
+    auto const profile_path = base + ".json";
+    std::ofstream {config_path} << R"(
+application:
+  entities:
+    - name: ROOT
+      loader_ref: RECORDER
+)";
+
+    lifecycle_log log;
+    ufw::application app;
+    app.register_loader("RECORDER", [&log](ufw::config_t const& cfg, ufw::entity_id const& id, ufw::resolved_entity_id rid, ufw::application& app)
+    {
+        return std::make_unique<stage_recorder>(log, cfg, id, rid, app);
+    });
+
+    char const* argv[] = {"test", "--config", config_path.c_str(), "--startup-profile", profile_path.c_str()};
+    app.load(5, argv);
+    app.run();
+
+    std::ifstream in {profile_path};
+    std::string const profile {std::istreambuf_iterator<char> {in}, std::istreambuf_iterator<char> {}};
+    std::remove(config_path.c_str());
+    std::remove(profile_path.c_str());
+
+    for (auto const* stage: {"\"entity\":\"app\",\"stage\":\"config\"", "\"entity\":\"ROOT\",\"stage\":\"load\"",
+                             "\"entity\":\"ROOT\",\"stage\":\"init\"", "\"entity\":\"ROOT\",\"stage\":\"start\""})
+        BOOST_REQUIRE_MESSAGE(profile.find(stage) != std::string::npos, stage);
+
+    // closed at UP
+    BOOST_REQUIRE(profile.find("\"stage\":\"stop\"") == std::string::npos);
+    BOOST_REQUIRE(app.startup().close().empty());
+} // BOOST_AUTO_TEST_CASE(startup_profile_test)
+
+BOOST_AUTO_TEST_CASE(config_cache_test) {
+    auto const base = "/tmp/ufw-config-cache-test-" + std::to_string(getpid());
+    auto const config_path = base + ".yaml";
+    auto const cache_path = base + ".bin";
+    std::ofstream {config_path} << R"(
+application:
+  bootstrap_threads: 2
+  entities:
+    - name: ROOT
+      loader_ref: RECORDER
+      config:
+        empty:
+        list: [1, "two", {three: 3}]
+)";
+
+    auto const load = [&](std::vector<char const*> args)
+    {
+        args.insert(args.begin(), {"test", "--config", config_path.c_str(), "--config-cache", cache_path.c_str()});
+        lifecycle_log log;
+        ufw::application app;
+        app.register_loader("RECORDER", [&log](ufw::config_t const& cfg, ufw::entity_id const& id, ufw::resolved_entity_id rid, ufw::application& app)
+        {
+            return std::make_unique<stage_recorder>(log, cfg, id, rid, app);
+        });
+        return app.load(int(args.size()), args.data());
+    };
+
+    // no cache yet, the YAML is loaded
+    BOOST_REQUIRE(!ufw::config_cache::read(cache_path, config_path));
+    load({});
+
+    BOOST_REQUIRE(!load({"--compile-config"}));
+    auto const cached = ufw::config_cache::read(cache_path, config_path);
+    BOOST_REQUIRE(cached);
+
+    // the values, not the styles
+    auto const app_cfg = (*cached)["application"].as<ufw::application_config>();
+    BOOST_REQUIRE_EQUAL(app_cfg.bootstrap_threads, 2u);
+    BOOST_REQUIRE_EQUAL(app_cfg.entities.at(0).loader_ref, "RECORDER");
+    auto const& cfg = app_cfg.entities.at(0).config;
+    BOOST_REQUIRE(cfg["empty"].IsNull());
+    BOOST_REQUIRE_EQUAL(cfg["list"][0].as<int>(), 1);
+    BOOST_REQUIRE_EQUAL(cfg["list"][1].as<std::string>(), "two");
+    BOOST_REQUIRE_EQUAL(cfg["list"][2]["three"].as<int>(), 3);
+    load({});
+
+    // an edit makes the cache stale
+    std::ofstream {config_path, std::ios::app} << "# edited\n";
+    BOOST_REQUIRE(!ufw::config_cache::read(cache_path, config_path));
+    BOOST_REQUIRE(load({}));
+
+    // a broken image is ignored as well, an old format or a cut one
+    BOOST_REQUIRE(!load({"--compile-config"}));
+    std::filesystem::resize_file(cache_path, std::filesystem::file_size(cache_path) - 3);
+    BOOST_REQUIRE(!ufw::config_cache::read(cache_path, config_path));
+    BOOST_REQUIRE(load({}));
+    {
+        std::fstream image {cache_path, std::ios::in | std::ios::out | std::ios::binary};
+        image.write("ufwcfg00", 8);
+    }
+    BOOST_REQUIRE(!ufw::config_cache::read(cache_path, config_path));
+    BOOST_REQUIRE(load({}));
+
+    std::remove(config_path.c_str());
+    std::remove(cache_path.c_str());
+} // BOOST_AUTO_TEST_CASE(config_cache_test)
+
+// a library every process has loaded
+#ifdef __APPLE__
+constexpr char const libc_name[] = "/usr/lib/libSystem.B.dylib";
+#else
+constexpr char const libc_name[] = "libc.so.6";
+#endif
+
+BOOST_AUTO_TEST_CASE(library_symbol_test)
+{
+    std::weak_ptr<ufw::library> weak;
+    ufw::symbol<int(int)> abs;
+    {
+        auto const lib = ufw::library::load(libc_name, true);
+        weak = lib;
+        abs = lib->symbol<int(int)>("abs");
+        BOOST_REQUIRE_THROW(lib->symbol<int(int)>("no_such_symbol"), std::runtime_error);
+    }
+
+    // the symbol keeps the library loaded
+    BOOST_REQUIRE(abs);
+    BOOST_REQUIRE_EQUAL(abs(-3), 3);
+    BOOST_REQUIRE(!weak.expired());
+
+    abs = {};
+    BOOST_REQUIRE(weak.expired());
+} // BOOST_AUTO_TEST_CASE(library_symbol_test)
+
+BOOST_AUTO_TEST_CASE(library_prefetch_test)
+{
+    auto const load = [](std::string const& filename)
+    {
+        ufw::application_config cfg;
+        cfg.bootstrap_threads = 2;
+        ufw::entity_config lib;
+        lib.name = "lib";
+        lib.loader_ref = "LIBRARY";
+        lib.config = YAML::Load("{filename: " + filename + "}");
+        cfg.entities.push_back(lib);
+
+        auto app = std::make_unique<ufw::application>();
+        app->add<ufw::library_repository>("LIBRARY");
+        app->load(cfg);
+        return app;
+    };
+
+    auto const app = load(libc_name);
+    BOOST_REQUIRE_EQUAL(app->get<ufw::library_entity>("lib").symbol<int(int)>("abs")(-2), 2);
+    auto const samples = app->startup().close();
+    BOOST_REQUIRE(std::any_of(samples.begin(), samples.end(), [](auto const& s) { return s.entity == "lib" && s.stage == std::string {"prefetch"}; }));
+
+    // the dlopen error from the pool
+    BOOST_REQUIRE_THROW(load("libufw_no_such_library.so"), std::runtime_error);
+} // BOOST_AUTO_TEST_CASE(library_prefetch_test)
+
+struct static_plugin: ufw::entity
+{
+    static_plugin(std::string tag, ufw::entity_id const& id, ufw::resolved_entity_id rid, ufw::application& app):
+        entity {id, rid, app},
+        tag {std::move(tag)}
+    {
+    }
+
+    std::string const tag;
+};
+
+ufw::entity* static_plugin_ctor(ufw::entity_id const& id, ufw::resolved_entity_id rid, ufw::application& app)
+{
+    return new static_plugin {"", id, rid, app};
+}
+
+ufw::entity* static_plugin_params_ctor(ufw::entity_id const& id, ufw::resolved_entity_id rid, ufw::application& app, ufw::config_t const& params)
+{
+    return new static_plugin {params["tag"].as<std::string>(), id, rid, app};
+}
+
+BOOST_AUTO_TEST_CASE(static_plugins_test)
+{
+    // what UFW_STATIC_PLUGIN does in the plugin
+    BOOST_REQUIRE(ufw::static_plugins::add("ufw_static_test", "static_plugin_ctor", &static_plugin_ctor));
+    BOOST_REQUIRE(ufw::static_plugins::add("ufw_static_test", "static_plugin_params_ctor", &static_plugin_params_ctor));
+    BOOST_REQUIRE(!ufw::static_plugins::add("ufw_static_test", "static_plugin_ctor", &static_plugin_ctor));
+
+    BOOST_REQUIRE_EQUAL(ufw::static_plugins::library_stem("/opt/ufw/lib/libufw_static_test.so.1"), "ufw_static_test");
+    BOOST_REQUIRE_EQUAL(ufw::static_plugins::library_stem("ufw_static_test.dylib"), "ufw_static_test");
+
+    auto const entity = [](std::string const& name, std::string const& loader, std::string const& yaml)
+    {
+        ufw::entity_config cfg;
+        cfg.name = name;
+        cfg.loader_ref = loader;
+        cfg.config = YAML::Load(yaml);
+        return cfg;
+    };
+
+    // the shared library config, no such file
+    ufw::application_config cfg;
+    cfg.entities.push_back(entity("lib", "LIBRARY", "{filename: libufw_static_test.so}"));
+    cfg.entities.push_back(entity("plugin", "PLUGIN", "{library_ref: lib, constructor: static_plugin_ctor}"));
+    cfg.entities.push_back(entity("with_params", "PLUGIN", "{library_ref: lib, constructor: static_plugin_params_ctor, params: {tag: x}}"));
+    cfg.entities.push_back(entity("static", "STATIC", "{constructor: static_plugin_params_ctor, params: {tag: y}}"));
+
+    ufw::application app;
+    app.add<ufw::library_repository>("LIBRARY");
+    app.add<ufw::plugin_repository>("PLUGIN");
+    app.add<ufw::static_plugin_repository>("STATIC");
+    app.load(cfg);
+
+    BOOST_REQUIRE_EQUAL(app.get<static_plugin>("plugin").tag, "");
+    BOOST_REQUIRE_EQUAL(app.get<static_plugin>("with_params").tag, "x");
+    BOOST_REQUIRE_EQUAL(app.get<static_plugin>("static").tag, "y");
+
+    ufw::application app2;
+    app2.add<ufw::static_plugin_repository>("STATIC");
+    ufw::application_config missing;
+    missing.entities.push_back(entity("missing", "STATIC", "{constructor: no_such_ctor}"));
+    BOOST_REQUIRE_THROW(app2.load(missing), ufw::fatal_error);
+} // BOOST_AUTO_TEST_CASE(static_plugins_test)
+
+#ifdef UFW_EXAMPLE_PLUGIN
+BOOST_AUTO_TEST_CASE(plugin_params_test)
+{
+    auto const load = [](char const* const filename, std::string const& plugin)
+    {
+        ufw::application_config cfg;
+        ufw::entity_config lib;
+        lib.name = "lib";
+        lib.loader_ref = "LIBRARY";
+        lib.config = YAML::Load(std::string {"{filename: "} + filename + "}");
+        cfg.entities.push_back(lib);
+        ufw::entity_config entity;
+        entity.name = "plugin";
+        entity.loader_ref = "PLUGIN";
+        entity.config = YAML::Load(plugin);
+        cfg.entities.push_back(entity);
+
+        ufw::application app;
+        app.add<ufw::library_repository>("LIBRARY");
+        app.add<ufw::plugin_repository>("PLUGIN");
+        app.load(cfg);
+    };
+
+    auto const loadgen = ufw::library::load(UFW_LOADGEN_PLUGIN);
+    BOOST_REQUIRE(loadgen->exports(ufw::plugin_params_tag("loadgen_ctor")));
+    BOOST_REQUIRE(!ufw::library::load(UFW_EXAMPLE_PLUGIN)->exports(ufw::plugin_params_tag("example_ctor")));
+
+    // the config not matching the constructor signature fails the load before the call
+    BOOST_REQUIRE_THROW(load(UFW_EXAMPLE_PLUGIN, "{library_ref: lib, constructor: example_ctor, params: {rate: 1}}"), ufw::fatal_error);
+    BOOST_REQUIRE_THROW(load(UFW_LOADGEN_PLUGIN, "{library_ref: lib, constructor: loadgen_ctor}"), ufw::fatal_error);
+} // BOOST_AUTO_TEST_CASE(plugin_params_test)
+
+BOOST_AUTO_TEST_CASE(plugin_shadowing_test)
+{
+    // linked in under the name of the shared library constructor
+    BOOST_REQUIRE(ufw::static_plugins::add("ufw_shadowing_test", "example_ctor", &static_plugin_ctor));
+
+    ufw::application_config cfg;
+    ufw::entity_config lib;
+    lib.name = "lib";
+    lib.loader_ref = "LIBRARY";
+    lib.config = YAML::Load(std::string {"{filename: "} + UFW_EXAMPLE_PLUGIN + "}");
+    cfg.entities.push_back(lib);
+    ufw::entity_config entity;
+    entity.name = "plugin";
+    entity.loader_ref = "PLUGIN";
+    entity.config = YAML::Load("{library_ref: lib, constructor: example_ctor}");
+    cfg.entities.push_back(entity);
+
+    ufw::application app;
+    app.add<ufw::library_repository>("LIBRARY");
+    app.add<ufw::plugin_repository>("PLUGIN");
+    app.load(cfg);
+
+    // the library loaded for real provides the constructor
+    BOOST_REQUIRE(!dynamic_cast<static_plugin*>(&app.get<ufw::entity>("plugin")));
+} // BOOST_AUTO_TEST_CASE(plugin_shadowing_test)
+#endif
+
 BOOST_AUTO_TEST_SUITE_END(/* ufw_app */)
 
 } // local namespace
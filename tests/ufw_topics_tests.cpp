@@ -5,9 +5,23 @@
 #include <boost/test/unit_test.hpp>
 
 #include <ufw/topics/topics.hpp>
+#include <ufw/topics/dispatcher.hpp>
 
 #include <string>
+#include <thread>
 #include <tuple>
+#include <vector>
+
+namespace {
+
+struct named_payload
+{
+    int value;
+};
+
+} // local namespace
+
+UFW_TOPIC_PAYLOAD(named_payload, "ufw.tests.named_payload");
 
 namespace {
 
@@ -27,6 +41,107 @@ BOOST_AUTO_TEST_CASE(topic_id_test) {
     BOOST_REQUIRE_NE(topic_id_for<sig_1>(sub_1), topic_id_for<sig_2>(sub_1));
 } // BOOST_AUTO_TEST_CASE(topic_id_test)
 
+BOOST_AUTO_TEST_CASE(topic_subject_interner_test) {
+    ufw::topic_subject_interner interner;
+
+    std::vector<std::thread> threads;
+    std::vector<std::vector<ufw::topic_subject_id_t>> ids(4);
+
+    for (auto& x: ids)
+        threads.emplace_back([&interner, &x]
+        {
+            for (int i = 0; i < 1000; ++i)
+            {
+                auto const subject = "subject." + std::to_string(i);
+                auto id = interner.find(subject);
+                if (!id) id = interner.insert(subject);
+                x.push_back(id);
+            }
+        });
+
+    for (auto& t: threads)
+        t.join();
+
+    BOOST_REQUIRE_EQUAL(interner.size(), 1000u);
+    for (auto& x: ids)
+        BOOST_REQUIRE(x == ids.front());
+
+    BOOST_REQUIRE_EQUAL(interner.find("subject.0"), ids.front().front());
+    BOOST_REQUIRE_EQUAL(interner.find("subject.1000"), 0u);
+} // BOOST_AUTO_TEST_CASE(topic_subject_interner_test)
+
+BOOST_AUTO_TEST_CASE(topic_subject_collision_test) {
+    ufw::topic_subject_interner interner;
+
+    // FNV-1a 32 collision
+    BOOST_REQUIRE_EQUAL(ufw::topic_subject_id_for("glbvs"), ufw::topic_subject_id_for("yacxa"));
+
+    BOOST_REQUIRE_NE(interner.insert("glbvs"), 0u);
+    BOOST_REQUIRE_EQUAL(interner.insert("yacxa"), 0u);
+    BOOST_REQUIRE_EQUAL(interner.collisions().size(), 1u);
+} // BOOST_AUTO_TEST_CASE(topic_subject_collision_test)
+
+BOOST_AUTO_TEST_CASE(static_topic_id_test) {
+    using ints = ufw::topic<int, "ints">;
+    using static_only = ufw::topic<int, "static.only">; // no run time lookups of the subject anywhere
+
+    static_assert(ints::id == ufw::make_topic_id(ufw::topic_payload_id_for<int>(), ufw::topic_subject_id_for("ints")));
+    static_assert(ints::id != ufw::topic<long, "ints">::id);
+    static_assert(ints::id != ufw::topic<int, "longs">::id);
+
+    // registered by the static initialization alone
+    BOOST_REQUIRE_EQUAL(ufw::topic_subjects().find(static_only::subject), ufw::topic_subject_id_for("static.only"));
+    BOOST_REQUIRE_EQUAL(static_only::id, ufw::make_topic_id(ufw::topic_payload_id_for<int>(), ufw::topic_subject_id_for("static.only")));
+
+    BOOST_REQUIRE_EQUAL(ints::id, ufw::topic_id_for<int>("ints"));
+
+    // the payload ID of a named payload type does not depend on the compiler
+    using named = ufw::topic<named_payload, "named">;
+    static_assert(ufw::topic_payload_id_for<named_payload>() == ufw::fnv1a_32("ufw.tests.named_payload"));
+    BOOST_REQUIRE_EQUAL(named::id, ufw::topic_id_for<named_payload>("named"));
+
+    BOOST_REQUIRE_NO_THROW(ufw::verify_topic_ids());
+} // BOOST_AUTO_TEST_CASE(static_topic_id_test)
+
+struct subscriber: ufw::entity
+{
+    subscriber(ufw::entity_id const& id, ufw::resolved_entity_id rid, ufw::application& app):
+        entity {id, rid, app}
+    {
+        auto& topics = app.get<ufw::dispatcher>("TOPICS");
+        topics.subscribe<int>("ints", [this](int x) { received.push_back(x); });
+        topics.subscribe<int>("ints", [this](int x) { received.push_back(-x); });
+        topics.subscribe<double>("ints", [this](double) { received.push_back(0); });
+    }
+
+    std::vector<int> received;
+};
+
+BOOST_AUTO_TEST_CASE(dispatcher_test) {
+    ufw::application app;
+    app.add<ufw::dispatcher>("TOPICS");
+    app.add<subscriber>("SUB");
+    app.load(ufw::application_config{});
+
+    auto& topics = app.get<ufw::dispatcher>("TOPICS");
+    auto& sub = app.get<subscriber>("SUB");
+
+    BOOST_REQUIRE_THROW(topics.subscribe<int>("ints", [](int) {}), ufw::fatal_error);
+
+    topics.init();
+
+    auto const ints = ufw::topic_id_for<int>("ints");
+    BOOST_REQUIRE_EQUAL(topics.subscribers(ints), 2u);
+    BOOST_REQUIRE_EQUAL(topics.subscribers(ufw::topic_id_for<int>("none")), 0u);
+
+    topics.publish(ints, 42);
+    topics.publish(ufw::topic_id_for<int>("none"), 13);
+
+    BOOST_REQUIRE_EQUAL(sub.received.size(), 2u);
+    BOOST_REQUIRE_EQUAL(sub.received[0], 42);
+    BOOST_REQUIRE_EQUAL(sub.received[1], -42);
+} // BOOST_AUTO_TEST_CASE(dispatcher_test)
+
 BOOST_AUTO_TEST_SUITE_END(/* ufw_topics */)
 
 } // local namespace
@@ -1,21 +1,34 @@
 #include "application.hpp"
 
+#include "clock_service.hpp"
+#include "config_cache.hpp"
 #include "exception_types.hpp"
 #include "configuration.hpp"
 #include "logger.hpp"
+#include "metrics_service.hpp"
+#include "trace_service.hpp"
 
 #include <boost/program_options.hpp>
 #include <boost/core/demangle.hpp>
 
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/signal_set.hpp>
+#include <boost/asio/thread_pool.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <string>
 #include <vector>
 #include <iostream>
+#include <iomanip>
 #include <fstream>
 #include <map>
+#include <optional>
+#include <queue>
+#include <sstream>
 #include <type_traits>
+#include <utility>
 
 namespace ufw {
 
@@ -52,8 +65,17 @@ private:
 };
 
 
-application::application()
+size_t application::next_interface_slot() noexcept
 {
+    static std::atomic<size_t> next {0};
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+application::application():
+    main_context_ {make_main_context("main", context_)}
+{
+    execution_context_ids_.emplace(main_context_->name(), main_context_.get());
+
     add<default_loader>("");
 
     register_loader("LOGGER", [&](config_t const& cfg, entity_id const& id, resolved_entity_id rid, application& app)
@@ -61,6 +83,28 @@ application::application()
         configure_logger(cfg.Scalar());
         return std::make_unique<entity>(id, rid, app);
     });
+
+    register_loader("CLOCK", [](config_t const& cfg, entity_id const& id, resolved_entity_id rid, application& app)
+    {
+        return std::make_unique<clock_service>(cfg, id, rid, app);
+    });
+
+    register_loader("METRICS", [](config_t const& cfg, entity_id const& id, resolved_entity_id rid, application& app)
+    {
+        return std::make_unique<metrics_service>(cfg, id, rid, app);
+    });
+
+    register_loader("TRACE", [](config_t const& cfg, entity_id const& id, resolved_entity_id rid, application& app)
+    {
+        return std::make_unique<trace_service>(cfg, id, rid, app);
+    });
+}
+
+application::~application()
+{
+    // the later entities first, a plugin goes before the library holding its code
+    while (!entities_.empty())
+        entities_.pop_back();
 }
 
 void application::register_loader(entity_id const& id, loader_func_t loader_func)
@@ -72,19 +116,27 @@ void application::register_loader(entity_id const& id, loader_func_t loader_func
 }
 
 // loader `loader_id` should be pre-registered for loader ID specified in the config
-resolved_entity_id application::add(entity_id const& id, entity_id const& loader_id, config_t const& cfg)
+resolved_entity_id application::add(entity_id const& id, entity_id const& loader_id, config_t const& cfg, std::string const& context_id)
 {
     if (structure_locked_)
         throw fatal_error("cannot load entity - application structure already locked, likely a bug in the code");
 
+    auto& context = context_id.empty() ? *main_context_ : find_context(context_id);
+
     resolved_entity_id const rid = entities_.size();
-    if (!entity_ids_.emplace(id, rid).second)
-        throw fatal_error("duplicate entity ID, check configuration");
+    intern_entity_id(id, rid);
+    UFW_TRACE_SCOPE("load", entity_names_.back().c_str());
+
+    entity_contexts_.push_back(&context);
+
+    auto const outer_rid = std::exchange(loading_rid_, rid);
+    startup_profile::scope const profiled {startup_profile_, id, "load"};
 
     auto loader_rid = resolve_entity_id(loader_id);
     if (loader_rid < entities_.size())
     {
         entities_.push_back(get<loader>(loader_rid).load(id, rid, cfg));
+        dependencies_.push_back({rid, loader_id, true});
         LOG_INF << "loaded with [" << loader_id << "<" << loader_rid << ">]: " << id << "<" << rid << ">";
     }
     else
@@ -93,29 +145,64 @@ resolved_entity_id application::add(entity_id const& id, entity_id const& loader
         LOG_INF << "loaded with loader function [" << loader_id << "]: " << id << "<" << rid << ">";
     }
 
+    loading_rid_ = outer_rid;
     return rid;
 }
 
-resolved_entity_id application::resolve_entity_id(entity_id const& id) const
+void application::intern_entity_id(entity_id const& id, resolved_entity_id const rid)
+{
+    if (entity_ids_.count(id))
+        throw fatal_error("duplicate entity ID, check configuration");
+
+    entity_ids_.emplace(entity_names_.emplace_back(id), rid);
+}
+
+resolved_entity_id application::resolve_entity_id(std::string_view const id) const
 {
     auto it = entity_ids_.find(id);
     return it == entity_ids_.end() ? -1 : it->second;
 }
 
+void application::add_dependency(resolved_entity_id const dependent, entity_id const& dependency)
+{
+    if (structure_locked_)
+        throw fatal_error("cannot add dependency - application structure already locked, likely a bug in the code");
+
+    dependencies_.push_back({dependent, dependency, true});
+}
+
+void application::note_reference(entity_id const& id)
+{
+    if (!structure_locked_ && loading_rid_ != resolved_entity_id(-1))
+        dependencies_.push_back({loading_rid_, id, false});
+}
+
 entity& application::get(resolved_entity_id rid) const
 {
     return get<entity>(rid);
 }
 
-void application::load(int argc, char const** argv)
+execution_context& application::find_context(std::string const& name) const
+{
+    auto it = execution_context_ids_.find(name);
+    if (it == execution_context_ids_.end())
+        throw fatal_error("no execution context " + name + ", check configuration");
+    return *it->second;
+}
+
+bool application::load(int argc, char const** argv)
 {
     namespace po = boost::program_options;
 
     std::string config_file = "config.yaml";
+    std::string config_cache_file;
     po::options_description desc {"Options"};
     desc.add_options()
         ("help,h", "Print this help message")
         ("config,c", po::value<std::string>(&config_file)->default_value(config_file), "application config file")
+        ("config-cache", po::value<std::string>(&config_cache_file), "binary image of the config file, used instead while up to date")
+        ("compile-config", "validate the config file and write the --config-cache image of it")
+        ("startup-profile", po::value<std::string>(&startup_profile_path_), "write the startup stage timings JSON to the file at UP")
     ;
 
     po::variables_map vm;
@@ -129,24 +216,56 @@ void application::load(int argc, char const** argv)
 
     po::notify(vm);
 
-    LOG_INF << "loading configuration from " << config_file;
-    std::ifstream in(config_file.c_str());
-    if (!in) throw std::runtime_error("config file not found");
-    YAML::Node node = YAML::Load(in);
+    if (vm.count("compile-config") && config_cache_file.empty())
+        throw fatal_error("--compile-config needs --config-cache");
 
-    load(node["application"].as<application_config>());
+    application_config cfg;
+    {
+        startup_profile::scope const profiled {startup_profile_, id(), "config"};
+        std::optional<YAML::Node> node;
+        if (!config_cache_file.empty() && !vm.count("compile-config"))
+        {
+            node = config_cache::read(config_cache_file, config_file);
+            if (node)
+            {
+                LOG_INF << "loading configuration from " << config_cache_file;
+            }
+            else
+            {
+                LOG_WRN << config_cache_file << " is missing, older than " << config_file << " or broken, falling back to YAML";
+            }
+        }
+
+        if (!node)
+        {
+            LOG_INF << "loading configuration from " << config_file;
+            std::ifstream in(config_file.c_str());
+            if (!in) throw std::runtime_error("config file not found");
+            node = YAML::Load(in);
+        }
+        cfg = (*node)["application"].as<application_config>();
+
+        if (vm.count("compile-config"))
+        {
+            config_cache::write(*node, config_file, config_cache_file);
+            LOG_INF << "compiled " << config_file << " to " << config_cache_file;
+            return false;
+        }
+    }
+
+    load(cfg);
+    return true;
 }
 
 void application::run()
 {
     LOG_STAMP_THREAD;
 
-    LOG_INF << "initializing lifecycle participants";
-    for (lifecycle_participant& x: lifecycle_participants_)
+    run_lifecycle_stage("init", false, [this](lifecycle_participant& x, entity const& e)
     {
-        LOG_INF << "initializing " << dynamic_cast<entity&>(x).id();
+        LOG_INF << "initializing " << e.id();
         x.init();
-    }
+    });
 
     terminal_signals_.async_wait([this](boost::system::error_code const& error, int signal_number)
     {
@@ -160,34 +279,285 @@ void application::run()
 
     LOG_INF << "scheduling lifecycle participants ping";
     for (lifecycle_participant& x: lifecycle_participants_)
-        context_.post([&x]{ x.up(); }); // TODO: VL: ping participants via their inboxes (once inboxes are implemented)
-    context_.post([this]{LOG_INF << "UP";});
+        post(x, [&x]{ x.up(); });
+    context_.post([this]
+    {
+        LOG_INF << "UP";
+        report_startup();
+    });
+    schedule_suppressed_logs_flush();
 
-    LOG_INF << "starting lifecycle participants";
-    for (lifecycle_participant& x: lifecycle_participants_)
+    LOG_INF << "starting execution contexts";
+    for (auto& x: execution_contexts_)
     {
-        LOG_INF << "starting " << dynamic_cast<entity&>(x).id();
-        x.start();
+        LOG_INF << "starting " << x->name();
+        x->start();
     }
 
+    run_lifecycle_stage("start", false, [this](lifecycle_participant& x, entity const& e)
+    {
+        LOG_INF << "starting " << e.id();
+        x.start();
+    });
+
     work_ = std::make_unique<boost::asio::io_context::work>(context_);
     context_.run();
 
-    std::reverse(begin(lifecycle_participants_), end(lifecycle_participants_));
+    LOG_INF << "stopping execution contexts";
+    for (auto it = execution_contexts_.rbegin(); it != execution_contexts_.rend(); ++it)
+    {
+        LOG_INF << "stopping " << (*it)->name();
+        (*it)->stop();
+    }
 
-    LOG_INF << "stopping lifecycle participants";
-    for (lifecycle_participant& x: lifecycle_participants_)
+    run_lifecycle_stage("stop", true, [this](lifecycle_participant& x, entity const& e)
     {
-        LOG_INF << "stopping " << dynamic_cast<entity&>(x).id();
+        LOG_INF << "stopping " << e.id();
         x.stop();
-    }
+    });
 
-    LOG_INF << "deinitializing lifecycle participants";
-    for (lifecycle_participant& x: lifecycle_participants_)
+    run_lifecycle_stage("fini", true, [this](lifecycle_participant& x, entity const& e)
     {
-        LOG_INF << "deinitializing " << dynamic_cast<entity&>(x).id();
+        LOG_INF << "deinitializing " << e.id();
         x.fini();
+    });
+
+    for (auto const& x: handler_monitor_.slowest())
+        LOG_INF << "slow handler: " << x.execution_ns / 1000 << " us in " << x.scope << " - " << x.label;
+
+    flush_suppressed_logs();
+}
+
+void application::run_lifecycle_stage(char const* const stage, bool const reverse,
+        std::function<void(lifecycle_participant&, entity const&)> const& f)
+{
+    using clock = std::chrono::steady_clock;
+
+    LOG_INF << "lifecycle stage " << stage << (bootstrap_threads_ ? " (parallel)" : "");
+
+    auto const n = lifecycle_participants_.size();
+    auto const& before = reverse ? lifecycle_dependents_ : lifecycle_dependencies_;
+    auto const& after = reverse ? lifecycle_dependencies_ : lifecycle_dependents_;
+
+    std::vector<clock::time_point> begins(n), ends(n);
+    auto const stage_begin = clock::now();
+
+    auto const run_one = [&](size_t const i)
+    {
+        UFW_TRACE_SCOPE(stage, lifecycle_entities_[i]->id().c_str());
+        startup_profile::scope const profiled {startup_profile_, lifecycle_entities_[i]->id(), stage};
+        begins[i] = clock::now();
+        f(lifecycle_participants_[i], *lifecycle_entities_[i]);
+        ends[i] = clock::now();
+    };
+
+    if (!bootstrap_threads_)
+    {
+        // the reverse of a topological order is a topological order of the reversed graph
+        if (reverse)
+            std::for_each(lifecycle_order_.rbegin(), lifecycle_order_.rend(), run_one);
+        else
+            std::for_each(lifecycle_order_.begin(), lifecycle_order_.end(), run_one);
+    }
+    else
+    {
+        auto const waiting = std::make_unique<std::atomic<size_t>[]>(n);
+        for (size_t i = 0; i < n; ++i)
+            waiting[i].store(before[i].size(), std::memory_order_relaxed);
+
+        boost::asio::thread_pool pool {bootstrap_threads_};
+        std::atomic<bool> failed {false};
+        std::exception_ptr error;
+
+        std::function<void(size_t)> schedule = [&](size_t const i)
+        {
+            boost::asio::post(pool, [&, i]
+            {
+                if (!failed.load(std::memory_order_relaxed))
+                {
+                    try
+                    {
+                        run_one(i);
+                    }
+                    catch (...)
+                    {
+                        if (!failed.exchange(true))
+                            error = std::current_exception();
+                        return;
+                    }
+                }
+
+                for (auto const j: after[i])
+                    if (waiting[j].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                        schedule(j);
+            });
+        };
+
+        for (size_t i = 0; i < n; ++i)
+            if (before[i].empty())
+                schedule(i);
+
+        pool.join();
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    if (!n)
+        return;
+
+    // the critical path ends with the participant done last and goes through the predecessors done last
+    auto const ms = [](clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+
+    size_t last = std::max_element(ends.begin(), ends.end()) - ends.begin();
+    std::vector<size_t> path {last};
+    while (!before[last].empty())
+    {
+        last = *std::max_element(before[last].begin(), before[last].end(), [&](size_t l, size_t r) { return ends[l] < ends[r]; });
+        path.push_back(last);
+    }
+
+    std::ostringstream report;
+    for (auto it = path.rbegin(); it != path.rend(); ++it)
+        report << (it == path.rbegin() ? "" : " -> ") << lifecycle_entities_[*it]->id()
+               << " " << std::fixed << std::setprecision(3) << ms(ends[*it] - begins[*it]) << "ms";
+
+    LOG_INF << "lifecycle stage " << stage << " took " << std::fixed << std::setprecision(3) << ms(clock::now() - stage_begin)
+            << "ms, critical path: " << report.str();
+}
+
+void application::report_startup()
+{
+    auto samples = startup_profile_.close();
+    if (samples.empty())
+        return;
+
+    if (!startup_profile_path_.empty())
+    {
+        std::ofstream out {startup_profile_path_, std::ios::trunc};
+        startup_profile::write_json(out, samples);
+        if (out)
+            LOG_INF << "startup profile written to " << startup_profile_path_;
+        else
+            LOG_ERR << "failed to write the startup profile to " << startup_profile_path_;
     }
+
+    constexpr size_t top = 10;
+    auto const n = std::min(top, samples.size());
+    std::partial_sort(samples.begin(), samples.begin() + n, samples.end(),
+            [](startup_profile::sample const& l, startup_profile::sample const& r) { return l.wall_ns > r.wall_ns; });
+
+    auto const ms = [](int64_t const ns) { return double(ns) / 1e6; };
+    LOG_INF << "startup profile, the slowest " << n << " of " << samples.size() << " stages (wall/cpu ms):";
+    for (size_t i = 0; i < n; ++i)
+        LOG_INF << "  " << std::fixed << std::setprecision(3) << ms(samples[i].wall_ns) << "/" << ms(samples[i].cpu_ns)
+                << " " << samples[i].stage << " " << samples[i].entity;
+}
+
+void application::lock_lifecycle_graph()
+{
+    auto const n = lifecycle_participants_.size();
+
+    std::vector<size_t> participant_index(entities_.size(), size_t(-1));
+    for (size_t i = 0; i < n; ++i)
+        participant_index[lifecycle_entities_[i]->resolved_id()] = i;
+
+    std::vector<std::vector<resolved_entity_id>> entity_dependencies(entities_.size());
+    for (auto const& d: dependencies_)
+    {
+        auto const target = resolve_entity_id(d.target);
+        if (target >= entities_.size())
+        {
+            if (d.required)
+                throw fatal_error(entities_.at(d.dependent)->id() + " depends on unknown entity " + d.target + ", check configuration");
+            continue;
+        }
+        if (target != d.dependent)
+            entity_dependencies[d.dependent].push_back(target);
+    }
+
+    dependencies_.clear();
+    dependencies_.shrink_to_fit();
+
+    // participants depend on participants, transitively through the plain entities in between
+    lifecycle_dependencies_.assign(n, {});
+    lifecycle_dependents_.assign(n, {});
+    for (size_t i = 0; i < n; ++i)
+    {
+        auto const rid = lifecycle_entities_[i]->resolved_id();
+        std::vector<bool> visited(entities_.size());
+        std::vector<resolved_entity_id> pending {rid};
+        visited[rid] = true;
+
+        while (!pending.empty())
+        {
+            auto const x = pending.back();
+            pending.pop_back();
+
+            for (auto const y: entity_dependencies[x])
+            {
+                if (visited[y]) continue;
+                visited[y] = true;
+
+                if (participant_index[y] != size_t(-1))
+                {
+                    lifecycle_dependencies_[i].push_back(participant_index[y]);
+                    lifecycle_dependents_[participant_index[y]].push_back(i);
+                }
+                else
+                    pending.push_back(y);
+            }
+        }
+    }
+
+    // Kahn's algorithm, the smallest declaration index first among the ready ones
+    std::vector<size_t> waiting(n);
+    std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>> ready;
+    for (size_t i = 0; i < n; ++i)
+        if (!(waiting[i] = lifecycle_dependencies_[i].size()))
+            ready.push(i);
+
+    lifecycle_order_.clear();
+    while (!ready.empty())
+    {
+        auto const i = ready.top();
+        ready.pop();
+        lifecycle_order_.push_back(i);
+        for (auto const j: lifecycle_dependents_[i])
+            if (!--waiting[j])
+                ready.push(j);
+    }
+
+    if (lifecycle_order_.size() != n)
+    {
+        std::string cycle;
+        for (size_t i = 0; i < n; ++i)
+            if (waiting[i])
+                cycle += (cycle.empty() ? "" : ", ") + lifecycle_entities_[i]->id();
+        throw fatal_error("lifecycle dependency cycle between " + cycle + ", check configuration");
+    }
+}
+
+void application::schedule_suppressed_logs_flush()
+{
+    suppressed_logs_timer_.expires_after(std::chrono::seconds(1));
+    suppressed_logs_timer_.async_wait([this](boost::system::error_code const& error)
+    {
+        if (error)
+            return;
+        flush_suppressed_logs();
+        schedule_suppressed_logs_flush();
+    });
+}
+
+void application::schedule_drain(lifecycle_participant& lp)
+{
+    lp.context_->post([this, &lp]
+    {
+        UFW_TRACE_SCOPE("drain", lp.name_);
+        if (lp.inbox().drain())
+            schedule_drain(lp);
+    });
 }
 
 void application::shutdown()
@@ -198,19 +568,91 @@ void application::shutdown()
 
 void application::load(application_config const& cfg)
 {
+    if (structure_locked_)
+        throw fatal_error("cannot load - application structure already locked, likely a bug in the code");
+
+    if (cfg.instrument_handlers)
+        main_context_->instrument(handler_monitor_.make_stats(main_context_->name(), cfg.handler_budget_us * 1000));
+
+    for (auto& context_cfg: cfg.execution_contexts)
+    {
+        auto context = context_cfg.type == "strand"
+                ? make_strand_context(context_cfg.name, find_context(context_cfg.context_ref))
+                : make_execution_context(context_cfg, [this](execution_context& x)
+                {
+                    LOG_ERR << "execution context " << x.name() << " failed, terminating main context";
+                    context_.stop();
+                });
+
+        if (!execution_context_ids_.emplace(context_cfg.name, context.get()).second)
+            throw fatal_error("duplicate execution context ID " + context_cfg.name + ", check configuration");
+
+        if (cfg.instrument_handlers)
+        {
+            auto const budget_us = context_cfg.handler_budget_us ? context_cfg.handler_budget_us : cfg.handler_budget_us;
+            context->instrument(handler_monitor_.make_stats(context_cfg.name, budget_us * 1000));
+        }
+
+        LOG_INF << "created " << context_cfg.type << " execution context " << context_cfg.name;
+        execution_contexts_.push_back(std::move(context));
+    }
+
+    // every prefetch is waited for by the load of its entity below, if one of those throws the pool
+    // destructor stops it and discards the queued prefetches, the libraries get opened by nobody then
+    std::optional<boost::asio::thread_pool> prefetch_pool;
+    if (cfg.bootstrap_threads)
+    {
+        prefetch_pool.emplace(cfg.bootstrap_threads);
+        for (auto const& entity_cfg: cfg.entities)
+        {
+            auto const loader_rid = resolve_entity_id(entity_cfg.loader_ref);
+            if (auto* const l = loader_rid < entities_.size() ? dynamic_cast<loader*>(entities_[loader_rid].get()) : nullptr)
+                l->prefetch(entity_cfg.name, entity_cfg.config, *prefetch_pool);
+        }
+    }
+
     for (auto& entity_cfg: cfg.entities)
-        add(entity_cfg.name, entity_cfg.loader_ref, entity_cfg.config);
+    {
+        auto const rid = add(entity_cfg.name, entity_cfg.loader_ref, entity_cfg.config, entity_cfg.context_ref);
+        inbox_configs_[rid] = entity_cfg.inbox;
+        if (!entity_cfg.log_level.empty())
+        {
+            logging::trivial::severity_level level;
+            if (!logging::trivial::from_string(entity_cfg.log_level.data(), entity_cfg.log_level.size(), level))
+                throw fatal_error("invalid log level " + entity_cfg.log_level + " of " + entity_cfg.name + ", check configuration");
+            get(rid).set_log_level(level);
+        }
+        for (auto const& dependency: entity_cfg.depends_on)
+            add_dependency(rid, dependency);
+    }
 
     entities_.shrink_to_fit();
 
     for_each<lifecycle_participant>([&](lifecycle_participant& lp)
     {
+        auto& e = dynamic_cast<entity&>(lp);
+        auto const rid = e.resolved_id();
+        auto const& inbox_cfg = inbox_configs_[rid];
+        lp.inbox_ = std::make_unique<inbox>(inbox_cfg.capacity, inbox_cfg.single_producer);
+        lp.context_ = entity_contexts_[rid];
+        lp.name_ = e.id().c_str();
+        if (cfg.instrument_handlers)
+            lp.stats_ = handler_monitor_.make_stats(e.id(), lp.context_->stats()->budget_ns);
         lifecycle_participants_.push_back(std::ref(lp));
+        lifecycle_entities_.push_back(&e);
     });
 
     lifecycle_participants_.shrink_to_fit();
+    lifecycle_entities_.shrink_to_fit();
+
+    bootstrap_threads_ = cfg.bootstrap_threads;
+    lock_lifecycle_graph();
 
     structure_locked_ = true;
+
+    // the interfaces the framework itself looks up
+    all<entity>();
+    all<lifecycle_participant>();
 }
 
 
@@ -18,29 +18,46 @@
 
 #include "exception_types.hpp"
 #include "configuration.hpp"
+#include "execution_context.hpp"
+#include "handler_monitor.hpp"
 #include "logger.hpp"
 #include "entity.hpp"
 #include "lifecycle_participant.hpp"
+#include "trace.hpp"
 #include "loader.hpp"
+#include "metrics.hpp"
+#include "startup_profile.hpp"
 
 #include <boost/program_options.hpp>
 #include <boost/core/demangle.hpp>
 
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/signal_set.hpp>
+#include <boost/asio/steady_timer.hpp>
 
+#include <array>
+#include <atomic>
+#include <deque>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <iostream>
 #include <fstream>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
 
 namespace ufw {
 
 struct application
 {
     application();
+    ~application();
 
     void register_loader(entity_id const& id, loader_func_t loader_func);
 
@@ -64,19 +81,28 @@ struct application
 
         resolved_entity_id const rid = entities_.size();
 
-        if (!entity_ids_.emplace(id, rid).second)
-            throw fatal_error("duplicate entity ID, check configuration");
-
+        intern_entity_id(id, rid);
+        entity_contexts_.push_back(main_context_.get());
+        auto const outer_rid = std::exchange(loading_rid_, rid);
         entities_.push_back(std::make_unique<T>(std::forward<Args>(args)..., id, rid, *this));
+        loading_rid_ = outer_rid;
 
         LOG_INF << "loaded with ctor: " << id << "<" << rid << ">";
         return rid;
     }
 
-    // loader `loader_id` should be pre-registered for loader ID specified in the config
-    resolved_entity_id add(entity_id const& id, entity_id const& loader_id, config_t const& cfg);
+    // loader `loader_id` should be pre-registered for loader ID specified in the config,
+    // `context_id` should be declared in the config, the main context is used if empty
+    resolved_entity_id add(entity_id const& id, entity_id const& loader_id, config_t const& cfg, std::string const& context_id = {});
+
+    resolved_entity_id resolve_entity_id(std::string_view id) const;
+
+    // `dependent` is initialized and started after, and stopped and deinitialized before `dependency`,
+    // resolved when the application structure is locked, throws fatal_error then if there is no such entity
+    void add_dependency(resolved_entity_id dependent, entity_id const& dependency);
 
-    resolved_entity_id resolve_entity_id(entity_id const& id) const;
+    // makes the entity being loaded, if any, depend on `id` if it exists, see entity_ref
+    void note_reference(entity_id const& id);
 
     template <class T>
     T& get(resolved_entity_id rid) const
@@ -97,17 +123,52 @@ struct application
     }
 
     template <class T>
-    T& get(entity_id const& id) const
+    T& get(std::string_view id) const
     {
         auto rid = resolve_entity_id(id);
         if (rid >= entities_.size())
-            throw fatal_error("no entity with ID " + id);
+            throw fatal_error("no entity with ID " + std::string {id});
         return get<T>(rid);
     }
 
+    // resolves and casts once, for the places get<T>() would be called repeatedly
+    template <class T>
+    entity_handle<T> handle(resolved_entity_id rid) const { return {get<T>(rid), rid}; }
+
+    template <class T>
+    entity_handle<T> handle(std::string_view id) const
+    {
+        auto rid = resolve_entity_id(id);
+        if (rid >= entities_.size())
+            throw fatal_error("no entity with ID " + std::string {id});
+        return handle<T>(rid);
+    }
+
+    // entities implementing T in the declaration order, built on the first request per type after
+    // the application structure is locked, the reference stays valid for the application lifetime,
+    // once built it is a pointer load away
+    template <class T>
+    std::vector<T*> const& all() const
+    {
+        auto const slot = interface_slot<T>();
+        if (slot < max_interface_slots) [[likely]]
+        {
+            if (auto const* index = interface_slots_[slot].load(std::memory_order_acquire))
+                return *static_cast<std::vector<T*> const*>(index);
+        }
+        return build_interface_index<T>(slot);
+    }
+
     template <class T, class F>
     void for_each(F const& f)
     {
+        if (structure_locked_)
+        {
+            for (auto* casted_ptr: all<T>())
+                f(*casted_ptr);
+            return;
+        }
+
         for (auto& base_ptr: entities_)
         {
             auto* casted_ptr = dynamic_cast<T*>(base_ptr.get());
@@ -118,27 +179,142 @@ struct application
 
     entity& get(resolved_entity_id rid) const;
 
-    void load(int argc, char const** argv);
+    // false if there is nothing to run, the config compiled with --compile-config
+    bool load(int argc, char const** argv);
+
+    // programmatic bootstrap, locks the application structure
+    void load(application_config const& cfg);
+
+    bool structure_locked() const noexcept { return structure_locked_; }
 
     void run();
 
     void shutdown();
 
+    // delivers the message through the participant inbox, throws transient_error if the inbox is full
+    template <class F>
+    void post(lifecycle_participant& to, F&& f)
+    {
+        bool const pushed = to.stats_
+                ? to.inbox().try_push(inbox::message_t {timed_handler<std::decay_t<F>> {to.stats_.get(), tsc_clock::monotonic_ns(), std::forward<F>(f)}})
+                : to.inbox().try_push(inbox::message_t {std::forward<F>(f)});
+        if (!pushed)
+            throw transient_error("inbox full");
+
+        if (to.inbox().schedule())
+            schedule_drain(to);
+    }
+
     boost::asio::io_context& context() { return context_; }
+
+    execution_context& context(resolved_entity_id rid) const { return *entity_contexts_.at(rid); }
+
+    // throws fatal_error if not declared
+    execution_context& find_context(std::string const& name) const;
+
+    metrics_registry& metrics() noexcept { return metrics_; }
+
+    // the slowest handlers table, filled with instrument_handlers on
+    handler_monitor const& handlers() const noexcept { return handler_monitor_; }
+
+    // recording until UP, loaders add own stages of the entities they load
+    startup_profile& startup() noexcept { return startup_profile_; }
 private:
     entity_id id() const { return "app"; } // for ENTITY_LOGGER macro to work
 
 private:
-    void load(application_config const& cfg);
+    // throws fatal_error on duplicates
+    void intern_entity_id(entity_id const& id, resolved_entity_id rid);
+
+    void schedule_drain(lifecycle_participant& lp);
+
+    void lock_lifecycle_graph();
+
+    // runs f over the lifecycle participants in the dependency order (or the reverse of it),
+    // in parallel on bootstrap_threads_ threads if set, and logs the stage critical path
+    void run_lifecycle_stage(char const* stage, bool reverse, std::function<void(lifecycle_participant&, entity const&)> const& f);
+
+    // logs the slowest startup stages and writes the profile JSON if asked
+    void report_startup();
+
+    // the counts of the rate limited and first n records suppressed, once a second on the main context
+    void schedule_suppressed_logs_flush();
+
+    metrics_registry metrics_;
+    handler_monitor handler_monitor_ {metrics_};
+    startup_profile startup_profile_;
+    std::string startup_profile_path_;
 
     boost::asio::io_context context_;
     boost::asio::signal_set terminal_signals_ {context_, SIGINT/*, SIGTERM*/};
+    boost::asio::steady_timer suppressed_logs_timer_ {context_};
     std::unique_ptr<boost::asio::io_context::work> work_;
 
+    std::unique_ptr<execution_context> main_context_;
+    std::vector<std::unique_ptr<execution_context>> execution_contexts_; // in declaration order
+    std::map<std::string, execution_context*> execution_context_ids_;
+    std::vector<execution_context*> entity_contexts_;
+
     std::vector<std::unique_ptr<entity>> entities_;
-    std::map<entity_id, size_t> entity_ids_;
+    std::deque<entity_id> entity_names_; // interned, stable addresses for the entity_ids_ keys
+    std::unordered_map<std::string_view, resolved_entity_id> entity_ids_;
+
+    // process-wide, the same slot for T in every application
+    static size_t next_interface_slot() noexcept;
+
+    template <class T>
+    static size_t interface_slot() noexcept
+    {
+        static size_t const slot = next_interface_slot();
+        return slot;
+    }
+
+    template <class T>
+    std::vector<T*> const& build_interface_index(size_t const slot) const
+    {
+        if (!structure_locked_)
+            throw fatal_error("cannot index entities - application structure not locked yet, likely a bug in the code");
+
+        std::lock_guard<std::mutex> lock {interface_index_mutex_};
+        auto& index = interface_index_[typeid(T)];
+        if (!index)
+        {
+            auto casted = std::make_shared<std::vector<T*>>();
+            for (auto& base_ptr: entities_)
+                if (auto* casted_ptr = dynamic_cast<T*>(base_ptr.get()))
+                    casted->push_back(casted_ptr);
+            index = std::move(casted);
+            if (slot < max_interface_slots)
+                interface_slots_[slot].store(index.get(), std::memory_order_release);
+        }
+        return *static_cast<std::vector<T*> const*>(index.get());
+    }
+
+    // written once per slot under the mutex, the types past the slots are looked up under it
+    static constexpr size_t max_interface_slots = 128;
+    mutable std::array<std::atomic<void const*>, max_interface_slots> interface_slots_ {};
+    mutable std::mutex interface_index_mutex_;
+    mutable std::unordered_map<std::type_index, std::shared_ptr<void>> interface_index_; // owns the indices
 
     std::vector<std::reference_wrapper<lifecycle_participant>> lifecycle_participants_;
+    std::vector<entity*> lifecycle_entities_; // the same objects, cast once
+    std::map<resolved_entity_id, inbox_config> inbox_configs_;
+
+    struct dependency
+    {
+        resolved_entity_id dependent;
+        entity_id target;
+        bool required; // false for entity_ref, an unresolved reference fails later on resolve()
+    };
+
+    std::vector<dependency> dependencies_;
+    resolved_entity_id loading_rid_ = -1;
+
+    // by the participant index in lifecycle_participants_
+    std::vector<std::vector<size_t>> lifecycle_dependencies_;
+    std::vector<std::vector<size_t>> lifecycle_dependents_;
+    std::vector<size_t> lifecycle_order_; // topological, the declaration order among independent participants
+    size_t bootstrap_threads_ {0};
 
     ENTITY_LOGGER;
 
@@ -146,13 +322,38 @@ private:
 };
 
 
+inline execution_context& entity::context() const
+{
+    return app_.context(rid_);
+}
+
+inline counter entity::make_counter(std::string const& name) const
+{
+    return app_.metrics().counter(id_ + "." + name);
+}
+
+inline gauge entity::make_gauge(std::string const& name) const
+{
+    return app_.metrics().gauge(id_ + "." + name);
+}
+
+inline histogram entity::make_histogram(std::string const& name) const
+{
+    return app_.metrics().histogram(id_ + "." + name);
+}
+
+template <class T>
+entity_ref<T>::entity_ref(entity_id const& id, application& app):
+        id_ {id},
+        app_ {app}
+{
+    app_.note_reference(id_);
+}
+
 template <class T>
 void entity_ref<T>::resolve()
 {
-    resolved_id_ = app_.resolve_entity_id(id_);
-    if (resolved_id_ == resolved_entity_id(-1))
-        throw fatal_error("no entity with ID " + id_);
-    target_ = &app_.get<T>(resolved_id_);
+    handle_ = app_.handle<T>(id_);
 }
 
 } // namespace ufw
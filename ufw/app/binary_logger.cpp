@@ -0,0 +1,387 @@
+#include "binary_logger.hpp"
+
+#include "clock.hpp"
+#include "inbox.hpp"
+
+#include <boost/log/attributes/constant.hpp>
+#include <boost/log/core.hpp>
+#include <boost/log/sources/record_ostream.hpp>
+#include <boost/date_time/c_local_time_adjustor.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace ufw {
+
+uint64_t get_tid() noexcept;
+
+std::string_view intern_log_name(std::string_view const name)
+{
+    static std::mutex mutex;
+    static auto* const names = new std::unordered_set<std::string> {}; // never freed, the views outlive everything
+
+    std::lock_guard<std::mutex> lock {mutex};
+    return *names->emplace(name).first;
+}
+
+std::atomic<int> log_threshold {int(boost::log::trivial::trace)};
+
+namespace binary_log {
+
+namespace {
+
+// the fixed part of a record in the ring, the arguments follow
+struct record_header
+{
+    site const* s;
+    char const* entity;
+    uint32_t entity_size;
+    uint32_t flags;
+    uint64_t tid;
+    int64_t timestamp_ns; // since the epoch
+};
+
+constexpr uint32_t truncated_flag = 1;
+constexpr uint32_t wrap_marker = ~uint32_t {0};
+
+constexpr size_t align8(size_t const x) { return (x + 7) & ~size_t {7}; }
+
+/*
+ * Single producer, single consumer byte ring of [u32 size][record] frames, 8-byte aligned.
+ * A frame never wraps around, the producer skips the tail with a wrap marker instead.
+ */
+struct byte_ring
+{
+    static constexpr size_t capacity = size_t {1} << 20;
+
+    bool try_write(record_header const& header, unsigned char const* args, size_t const args_size) noexcept
+    {
+        size_t const size = sizeof(header) + args_size;
+        size_t const frame = align8(sizeof(uint32_t) + size);
+
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        uint64_t const head = head_.load(std::memory_order_acquire);
+
+        size_t const offset = tail & (capacity - 1);
+        size_t const padding = offset + frame > capacity ? capacity - offset : 0;
+        if (tail + padding + frame - head > capacity)
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        if (padding)
+        {
+            std::memcpy(data_.get() + offset, &wrap_marker, sizeof(wrap_marker));
+            tail += padding;
+        }
+
+        unsigned char* const p = data_.get() + (tail & (capacity - 1));
+        uint32_t const size32 = uint32_t(size);
+        std::memcpy(p, &size32, sizeof(size32));
+        std::memcpy(p + sizeof(size32), &header, sizeof(header));
+        std::memcpy(p + sizeof(size32) + sizeof(header), args, args_size);
+
+        tail_.store(tail + frame, std::memory_order_release);
+        return true;
+    }
+
+    // consumer only
+    template <class F>
+    size_t drain(F&& f)
+    {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        uint64_t const tail = tail_.load(std::memory_order_acquire);
+        size_t n = 0;
+
+        while (head != tail)
+        {
+            size_t const offset = head & (capacity - 1);
+            uint32_t size;
+            std::memcpy(&size, data_.get() + offset, sizeof(size));
+
+            if (size == wrap_marker)
+            {
+                head += capacity - offset;
+                continue;
+            }
+
+            f(data_.get() + offset + sizeof(size), size);
+            head += align8(sizeof(size) + size);
+            ++n;
+        }
+
+        head_.store(head, std::memory_order_release);
+        return n;
+    }
+
+    bool empty() const noexcept
+    {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    std::atomic<bool> closed {false};
+    std::atomic<uint64_t> dropped {0};
+
+private:
+    std::unique_ptr<unsigned char[]> const data_ {new unsigned char[capacity]};
+
+    alignas(cache_line_size) std::atomic<uint64_t> tail_ {0};
+    alignas(cache_line_size) std::atomic<uint64_t> head_ {0};
+};
+
+/*
+ * Drains the thread rings, formats the records and pushes them through the Boost.Log core
+ * with the attributes the synchronous path sets, so the configured sinks and formats apply.
+ */
+struct backend
+{
+    backend(): thread_ {[this] { run(); }} {}
+
+    ~backend()
+    {
+        stopped_.store(true, std::memory_order_relaxed);
+        wakeup_.notify_one();
+        thread_.join();
+    }
+
+    std::shared_ptr<byte_ring> add_ring()
+    {
+        auto ring = std::make_shared<byte_ring>();
+        std::lock_guard<std::mutex> lock {mutex_};
+        rings_.push_back(ring);
+        return ring;
+    }
+
+    void flush()
+    {
+        auto const target = flushes_requested_.fetch_add(1) + 1; // ordered after the caller records
+        wakeup_.notify_one();
+        while (flushes_done_.load(std::memory_order_acquire) < target)
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+
+    uint64_t dropped() const
+    {
+        std::lock_guard<std::mutex> lock {mutex_};
+        uint64_t n = dropped_;
+        for (auto const& ring: rings_)
+            n += ring->dropped.load(std::memory_order_relaxed);
+        return n;
+    }
+
+private:
+    void run()
+    {
+        std::vector<std::shared_ptr<byte_ring>> rings;
+
+        for (;;)
+        {
+            auto const flush_target = flushes_requested_.load();
+            bool const stopping = stopped_.load(std::memory_order_relaxed);
+
+            {
+                std::lock_guard<std::mutex> lock {mutex_};
+                // the rings of exited threads go once drained
+                for (auto it = rings_.begin(); it != rings_.end();)
+                {
+                    if ((*it)->closed.load(std::memory_order_acquire) && (*it)->empty())
+                    {
+                        dropped_ += (*it)->dropped.load(std::memory_order_relaxed);
+                        it = rings_.erase(it);
+                    }
+                    else
+                        ++it;
+                }
+                rings = rings_;
+            }
+
+            size_t n = 0;
+            for (auto& ring: rings)
+                n += ring->drain([this](unsigned char const* p, size_t size) { forward(p, size); });
+
+            if (n)
+                continue;
+
+            flushes_done_.store(flush_target, std::memory_order_release);
+            if (stopping)
+                break;
+
+            std::unique_lock<std::mutex> lock {wakeup_mutex_};
+            wakeup_.wait_for(lock, std::chrono::milliseconds(1));
+        }
+    }
+
+    void forward(unsigned char const* const p, size_t const size)
+    {
+        namespace logging = boost::log;
+        namespace attrs = boost::log::attributes;
+
+        record_header header;
+        std::memcpy(&header, p, sizeof(header));
+        site const& s = *header.s;
+
+        auto const utc = boost::posix_time::from_time_t(0)
+                + boost::posix_time::microseconds(header.timestamp_ns / 1000);
+
+        logging::attribute_set attributes;
+        attributes.insert("Severity", attrs::constant<severity_level>(s.severity));
+        attributes.insert("Entity", attrs::constant<std::string>(std::string {header.entity, header.entity_size}));
+        attributes.insert("Tag", attrs::constant<std::string>(s.tag));
+        attributes.insert("File", attrs::constant<std::string>(s.file));
+        attributes.insert("Line", attrs::constant<int>(s.line));
+        attributes.insert("Func", attrs::constant<std::string>(s.func));
+        attributes.insert("ThreadPID", attrs::constant<uint64_t>(header.tid));
+        attributes.insert("TimeStamp", attrs::constant<boost::posix_time::ptime>(
+                boost::date_time::c_local_adjustor<boost::posix_time::ptime>::utc_to_local(utc)));
+
+        auto record = logging::core::get()->open_record(attributes);
+        if (!record)
+            return;
+
+        {
+            logging::record_ostream out {record};
+            decode(out.stream(), p + sizeof(header), size - sizeof(header));
+            if (header.flags & truncated_flag)
+                out << "...";
+        }
+        logging::core::get()->push_record(std::move(record));
+    }
+
+    static void decode(std::ostream& out, unsigned char const* p, size_t size)
+    {
+        auto const read = [&](auto& x)
+        {
+            std::memcpy(&x, p, sizeof(x));
+            p += sizeof(x);
+            size -= sizeof(x);
+        };
+
+        while (size)
+        {
+            auto const type = arg_type(*p++);
+            --size;
+
+            switch (type)
+            {
+            case arg_type::i64: { int64_t x; read(x); out << x; break; }
+            case arg_type::u64: { uint64_t x; read(x); out << x; break; }
+            case arg_type::f64: { double x; read(x); out << x; break; }
+            case arg_type::boolean: { uint8_t x; read(x); out << bool(x); break; }
+            case arg_type::character: { char x; read(x); out << x; break; }
+            case arg_type::string:
+            {
+                uint32_t n;
+                read(n);
+                out.write(reinterpret_cast<char const*>(p), n);
+                p += n;
+                size -= n;
+                break;
+            }
+            }
+        }
+    }
+
+    mutable std::mutex mutex_;
+    std::vector<std::shared_ptr<byte_ring>> rings_;
+    uint64_t dropped_ {0}; // of the rings already gone
+
+    std::mutex wakeup_mutex_;
+    std::condition_variable wakeup_;
+    std::atomic<uint64_t> flushes_requested_ {0};
+    std::atomic<uint64_t> flushes_done_ {0};
+    std::atomic<bool> stopped_ {false};
+
+    std::thread thread_;
+};
+
+backend& get_backend()
+{
+    static backend instance;
+    return instance;
+}
+
+struct thread_ring
+{
+    std::shared_ptr<byte_ring> const ring {get_backend().add_ring()};
+    uint64_t const tid {get_tid()};
+
+    ~thread_ring() { ring->closed.store(true, std::memory_order_release); }
+};
+
+thread_ring& local_ring()
+{
+    thread_local thread_ring r;
+    return r;
+}
+
+} // local namespace
+
+record_writer::record_writer(log_source const& source, site const& s) noexcept:
+    size_ {sizeof(record_header)}
+{
+    record_header const header {&s, source.entity.data(), uint32_t(source.entity.size()), 0, 0,
+            tsc_clock::wall_ns()};
+    std::memcpy(buffer_, &header, sizeof(header));
+}
+
+record_writer::~record_writer()
+{
+    if (eager_)
+        put_string(eager_->str());
+
+    auto& local = local_ring();
+
+    record_header header;
+    std::memcpy(&header, buffer_, sizeof(header));
+    header.tid = local.tid;
+    header.flags = truncated_ ? truncated_flag : 0;
+
+    local.ring->try_write(header, buffer_ + sizeof(header), size_ - sizeof(header));
+}
+
+void record_writer::put_string(std::string_view s) noexcept
+{
+    size_t const room = max_record_size - std::min(max_record_size, size_ + 1 + sizeof(uint32_t));
+    if (s.size() > room)
+    {
+        truncated_ = true;
+        s = s.substr(0, room);
+        if (size_ + 1 + sizeof(uint32_t) > max_record_size)
+            return;
+    }
+
+    buffer_[size_++] = static_cast<unsigned char>(arg_type::string);
+    uint32_t const n = uint32_t(s.size());
+    std::memcpy(buffer_ + size_, &n, sizeof(n));
+    size_ += sizeof(n);
+    std::memcpy(buffer_ + size_, s.data(), n);
+    size_ += n;
+}
+
+std::ostream& record_writer::eager()
+{
+    if (!eager_)
+        eager_.emplace();
+    return *eager_;
+}
+
+void flush()
+{
+    get_backend().flush();
+}
+
+uint64_t dropped() noexcept
+{
+    return get_backend().dropped();
+}
+
+} // namespace binary_log
+} // namespace ufw
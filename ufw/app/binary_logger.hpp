@@ -0,0 +1,166 @@
+/* Copyright (c) 2026 Vladimir Lysyy (mrbald@github)
+ * ALv2 (http://www.apache.org/licenses/LICENSE-2.0)
+ */
+
+#pragma once
+
+#include <boost/log/trivial.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace ufw {
+
+// what a logger call site needs to know about the logging entity, the name is interned and never freed
+struct log_source
+{
+    std::string_view entity;
+    std::atomic<int> level {-1}; // the entity runtime log level, -1 follows log_threshold
+};
+
+// the global runtime log level, set by SET_LOG_LEVEL
+extern std::atomic<int> log_threshold;
+
+// checked on the call site before any attribute or argument work, branch-free but for the result
+inline bool log_enabled(log_source const& source, boost::log::trivial::severity_level const severity) noexcept
+{
+    int const own = source.level.load(std::memory_order_relaxed);
+    int const global = log_threshold.load(std::memory_order_relaxed);
+    return int(severity) >= (own < 0 ? global : own);
+}
+
+// stable storage for log source names, which may outlive the entities they name
+std::string_view intern_log_name(std::string_view name);
+
+// the outcome of a call site limiter, see LOG_SEV_LIMITED, a record admitted after a burst tells how many were dropped
+struct log_admission
+{
+    bool admitted;
+    uint64_t suppressed {0};
+
+    explicit operator bool() const noexcept { return admitted; }
+};
+
+inline std::ostream& operator<<(std::ostream& out, log_admission const& x)
+{
+    if (x.suppressed)
+        out << "[" << x.suppressed << " suppressed] ";
+    return out;
+}
+
+namespace binary_log {
+
+using severity_level = boost::log::trivial::severity_level;
+
+// static per call site, the records refer to it instead of carrying the strings
+struct site
+{
+    char const* file;
+    int line;
+    char const* func;
+    char const* tag;
+    severity_level severity;
+};
+
+enum class arg_type: uint8_t { i64, u64, f64, boolean, character, string };
+
+/**
+ * Collects a record on the stack - the call site, the source, and the raw arguments,
+ * and on destruction copies it into the per-thread ring the backend thread drains.
+ *
+ * Arithmetic and string arguments are stored as is and formatted on the backend thread.
+ * Anything else, manipulators included, is formatted right away into a stream that then
+ * also takes all the arguments after it, so the manipulators apply as usual.
+ */
+struct record_writer
+{
+    static constexpr size_t max_record_size = 1024;
+
+    record_writer(log_source const& source, site const& s) noexcept;
+    ~record_writer();
+
+    record_writer(record_writer const&) = delete;
+    record_writer& operator=(record_writer const&) = delete;
+
+    template <class T>
+    record_writer& operator<<(T const& x)
+    {
+        if (eager_)
+            *eager_ << x;
+        else if constexpr (std::is_same_v<T, bool>)
+            put(arg_type::boolean, uint8_t(x));
+        else if constexpr (std::is_same_v<T, char>)
+            put(arg_type::character, x);
+        else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+            put(arg_type::i64, int64_t(x));
+        else if constexpr (std::is_integral_v<T>)
+            put(arg_type::u64, uint64_t(x));
+        else if constexpr (std::is_floating_point_v<T>)
+            put(arg_type::f64, double(x));
+        else if constexpr (std::is_convertible_v<T const&, std::string_view>)
+            put_string(std::string_view {x});
+        else
+            eager() << x;
+        return *this;
+    }
+
+    record_writer& operator<<(log_admission const& x)
+    {
+        if (eager_)
+            *eager_ << x;
+        else if (x.suppressed)
+            *this << "[" << x.suppressed << " suppressed] ";
+        return *this;
+    }
+
+    record_writer& operator<<(std::ostream& (*manipulator)(std::ostream&))
+    {
+        eager() << manipulator;
+        return *this;
+    }
+
+    record_writer& operator<<(std::ios_base& (*manipulator)(std::ios_base&))
+    {
+        eager() << manipulator;
+        return *this;
+    }
+
+private:
+    template <class T>
+    void put(arg_type const type, T const x) noexcept
+    {
+        if (size_ + 1 + sizeof(T) > max_record_size)
+        {
+            truncated_ = true;
+            return;
+        }
+        buffer_[size_++] = static_cast<unsigned char>(type);
+        std::memcpy(buffer_ + size_, &x, sizeof(T));
+        size_ += sizeof(T);
+    }
+
+    void put_string(std::string_view s) noexcept;
+    std::ostream& eager();
+
+    size_t size_;
+    bool truncated_ {false};
+    std::optional<std::ostringstream> eager_;
+    alignas(8) unsigned char buffer_[max_record_size];
+};
+
+// blocks until the records logged so far by all threads are handed over to Boost.Log
+void flush();
+
+// records dropped since the start because a thread ring was full
+uint64_t dropped() noexcept;
+
+} // namespace binary_log
+} // namespace ufw
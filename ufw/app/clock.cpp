@@ -0,0 +1,131 @@
+#include "clock.hpp"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#ifdef UFW_HAS_TSC
+#include <cpuid.h>
+#endif
+
+namespace ufw {
+
+alignas(64) tsc_clock::state tsc_clock::state_;
+
+namespace {
+
+struct sample
+{
+    uint64_t ticks;
+    int64_t wall_ns;
+    int64_t monotonic_ns;
+};
+
+int64_t system_ns(clockid_t const id)
+{
+    timespec ts;
+    clock_gettime(id, &ts);
+    return int64_t(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+}
+
+// the counter read closest to a clock_gettime() pair out of a few tries
+sample take_sample()
+{
+    sample best {};
+    int64_t best_gap = INT64_MAX;
+
+    for (int i = 0; i < 16; ++i)
+    {
+        auto const before = system_ns(CLOCK_MONOTONIC);
+        auto const ticks = tsc_clock::ticks();
+        auto const after = system_ns(CLOCK_MONOTONIC);
+        auto const wall = system_ns(CLOCK_REALTIME);
+
+        if (after - before < best_gap)
+        {
+            best_gap = after - before;
+            best = {ticks, wall - (after - before) / 2, before + (after - before) / 2};
+        }
+    }
+
+    return best;
+}
+
+bool invariant_tsc()
+{
+#ifdef UFW_HAS_TSC
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+        return false;
+    return edx & (1u << 8);
+#else
+    return false;
+#endif
+}
+
+constexpr auto calibration_window = std::chrono::milliseconds(20);
+
+std::mutex calibration_mutex;
+sample origin; // of the calibration, the rate is refined over the time since
+} // local namespace
+
+double tsc_clock::frequency_ghz() noexcept
+{
+    auto const ns_per_tick = state_.ns_per_tick.load(std::memory_order_relaxed);
+    return ns_per_tick ? 1 / ns_per_tick : 0;
+}
+
+bool tsc_clock::calibrate()
+{
+    if (!invariant_tsc())
+        return false;
+
+    std::lock_guard<std::mutex> lock {calibration_mutex};
+
+    auto const first = take_sample();
+    std::this_thread::sleep_for(calibration_window);
+    auto const last = take_sample();
+
+    if (last.ticks <= first.ticks)
+        return false;
+
+    origin = first;
+
+    auto const sequence = state_.sequence.load(std::memory_order_relaxed);
+    state_.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    state_.base_ticks.store(last.ticks, std::memory_order_relaxed);
+    state_.wall_base_ns.store(last.wall_ns, std::memory_order_relaxed);
+    state_.monotonic_base_ns.store(last.monotonic_ns, std::memory_order_relaxed);
+    state_.ns_per_tick.store(double(last.monotonic_ns - first.monotonic_ns) / double(last.ticks - first.ticks), std::memory_order_relaxed);
+    state_.sequence.store(sequence + 2, std::memory_order_release);
+
+    return true;
+}
+
+void tsc_clock::resync()
+{
+    if (!calibrated())
+        return;
+
+    std::lock_guard<std::mutex> lock {calibration_mutex};
+
+    auto const now = take_sample();
+    if (now.ticks <= origin.ticks)
+        return;
+
+    // continuous at the new base, only the rate changes
+    auto const monotonic_ns = state_.monotonic_base_ns.load(std::memory_order_relaxed)
+            + int64_t(double(int64_t(now.ticks - state_.base_ticks.load(std::memory_order_relaxed))) * state_.ns_per_tick.load(std::memory_order_relaxed));
+
+    auto const sequence = state_.sequence.load(std::memory_order_relaxed);
+    state_.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    state_.base_ticks.store(now.ticks, std::memory_order_relaxed);
+    state_.wall_base_ns.store(now.wall_ns, std::memory_order_relaxed);
+    state_.monotonic_base_ns.store(monotonic_ns, std::memory_order_relaxed);
+    state_.ns_per_tick.store(double(now.monotonic_ns - origin.monotonic_ns) / double(now.ticks - origin.ticks), std::memory_order_relaxed);
+    state_.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+} // namespace ufw
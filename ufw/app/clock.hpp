@@ -0,0 +1,99 @@
+/* Copyright (c) 2026 Vladimir Lysyy (mrbald@github)
+ * ALv2 (http://www.apache.org/licenses/LICENSE-2.0)
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define UFW_HAS_TSC 1
+#endif
+
+namespace ufw {
+
+/**
+ * Wall and monotonic nanosecond timestamps extrapolated from the CPU time stamp counter.
+ *
+ * calibrate() measures the counter rate against clock_gettime() and anchors both clocks,
+ * resync() re-anchors the wall clock and refines the rate over the time since calibration,
+ * keeping the monotonic clock continuous. Until calibrated, on CPUs without an invariant
+ * TSC, and off x86 the readings come from clock_gettime() directly.
+ *
+ * The calibration is process-wide and published with a seqlock, so a reading is a counter
+ * read, a handful of relaxed loads and a multiply. The CLOCK entity (see clock_service.hpp)
+ * calibrates at init() and resyncs periodically.
+ */
+struct tsc_clock
+{
+    // nanoseconds since the epoch
+    static int64_t wall_ns() noexcept { return now(true); }
+
+    // nanoseconds since an arbitrary point, never goes back
+    static int64_t monotonic_ns() noexcept { return now(false); }
+
+    static uint64_t ticks() noexcept
+    {
+#ifdef UFW_HAS_TSC
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+    static bool calibrated() noexcept { return state_.ns_per_tick.load(std::memory_order_relaxed) != 0; }
+
+    // ticks per nanosecond, 0 if not calibrated
+    static double frequency_ghz() noexcept;
+
+    // blocks for the calibration window, returns false if the TSC is not usable
+    static bool calibrate();
+
+    static void resync();
+
+private:
+    struct state
+    {
+        std::atomic<uint32_t> sequence {0}; // odd while being updated
+        std::atomic<uint64_t> base_ticks {0};
+        std::atomic<int64_t> wall_base_ns {0};
+        std::atomic<int64_t> monotonic_base_ns {0};
+        std::atomic<double> ns_per_tick {0}; // 0 - not calibrated
+    };
+
+    static int64_t now(bool const wall) noexcept
+    {
+        for (;;)
+        {
+            auto const sequence = state_.sequence.load(std::memory_order_acquire);
+            auto const ticks = tsc_clock::ticks();
+            auto const base_ticks = state_.base_ticks.load(std::memory_order_relaxed);
+            auto const base_ns = (wall ? state_.wall_base_ns : state_.monotonic_base_ns).load(std::memory_order_relaxed);
+            auto const ns_per_tick = state_.ns_per_tick.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if ((sequence & 1) || state_.sequence.load(std::memory_order_relaxed) != sequence)
+                continue;
+
+            if (ns_per_tick == 0)
+                return system_ns(wall);
+
+            return base_ns + int64_t(double(int64_t(ticks - base_ticks)) * ns_per_tick);
+        }
+    }
+
+    static int64_t system_ns(bool const wall) noexcept
+    {
+        timespec ts;
+        clock_gettime(wall ? CLOCK_REALTIME : CLOCK_MONOTONIC, &ts);
+        return int64_t(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+    }
+
+    alignas(64) static state state_;
+};
+
+} // namespace ufw
@@ -0,0 +1,47 @@
+#include "clock_service.hpp"
+
+#include "application.hpp"
+
+#include <iomanip>
+
+namespace ufw {
+
+clock_service::clock_service(config_t const& cfg, entity_id const& id, resolved_entity_id rid, application& app):
+    entity {id, rid, app},
+    resync_interval_ {cfg["resync_interval_ms"] ? cfg["resync_interval_ms"].as<int64_t>() : 1000},
+    timer_ {context().get_executor()}
+{
+}
+
+void clock_service::init()
+{
+    if (tsc_clock::calibrate())
+        LOG_INF << "calibrated TSC at " << std::fixed << std::setprecision(6) << tsc_clock::frequency_ghz() << " GHz";
+    else
+        LOG_WRN << "no invariant TSC, falling back to clock_gettime()";
+}
+
+void clock_service::start()
+{
+    if (tsc_clock::calibrated())
+        app().post(*this, [this] { schedule_resync(); });
+}
+
+void clock_service::stop() noexcept
+{
+    timer_.cancel(); // the execution contexts are stopped by now
+}
+
+void clock_service::schedule_resync()
+{
+    timer_.expires_after(resync_interval_);
+    timer_.async_wait(recycling([this](boost::system::error_code const& ec)
+    {
+        if (ec)
+            return;
+        tsc_clock::resync();
+        schedule_resync();
+    }));
+}
+
+} // namespace ufw
@@ -0,0 +1,38 @@
+/* Copyright (c) 2026 Vladimir Lysyy (mrbald@github)
+ * ALv2 (http://www.apache.org/licenses/LICENSE-2.0)
+ */
+
+#pragma once
+
+#include "clock.hpp"
+#include "configuration.hpp"
+#include "entity.hpp"
+#include "lifecycle_participant.hpp"
+
+#include <boost/asio/steady_timer.hpp>
+
+#include <chrono>
+
+namespace ufw {
+
+/**
+ * The CLOCK entity, calibrates tsc_clock at init() and resyncs it every `resync_interval_ms`
+ * (1000 by default) on its execution context. Entities depending on calibrated timestamps
+ * from their own init() should list it in `depends_on`.
+ */
+struct clock_service: entity, lifecycle_participant
+{
+    clock_service(config_t const& cfg, entity_id const& id, resolved_entity_id rid, application& app);
+
+    void init() override;
+    void start() override;
+    void stop() noexcept override;
+
+private:
+    void schedule_resync();
+
+    std::chrono::milliseconds const resync_interval_;
+    boost::asio::steady_timer timer_;
+};
+
+} // namespace ufw
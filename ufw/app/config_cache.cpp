@@ -0,0 +1,246 @@
+#include "config_cache.hpp"
+
+#include "exception_types.hpp"
+#include "logger.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ufw {
+
+namespace {
+
+constexpr char magic[8] = {'u', 'f', 'w', 'c', 'f', 'g', '0', '1'};
+
+enum node_kind: uint8_t { null_node, scalar_node, sequence_node, map_node };
+
+// a truncated or corrupt image, the YAML is parsed instead
+struct bad_image: std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+struct header
+{
+    char magic[8];
+    int64_t source_mtime; // file clock ticks
+    uint64_t source_size;
+};
+
+struct source_stamp
+{
+    int64_t mtime;
+    uint64_t size;
+};
+
+std::optional<source_stamp> stamp(std::string const& path)
+{
+    std::error_code ec;
+    auto const mtime = std::filesystem::last_write_time(path, ec);
+    if (ec)
+        return std::nullopt;
+    auto const size = std::filesystem::file_size(path, ec);
+    if (ec)
+        return std::nullopt;
+    return source_stamp {int64_t(mtime.time_since_epoch().count()), uint64_t(size)};
+}
+
+template <class T>
+void put(std::string& out, T const value)
+{
+    out.append(reinterpret_cast<char const*>(&value), sizeof(value));
+}
+
+void encode(std::string& out, config_t const& node)
+{
+    switch (node.Type())
+    {
+    case YAML::NodeType::Scalar:
+        put(out, scalar_node);
+        put(out, uint32_t(node.Scalar().size()));
+        out += node.Scalar();
+        break;
+    case YAML::NodeType::Sequence:
+        put(out, sequence_node);
+        put(out, uint32_t(node.size()));
+        for (auto const& child: node)
+            encode(out, child);
+        break;
+    case YAML::NodeType::Map:
+        put(out, map_node);
+        put(out, uint32_t(node.size()));
+        for (auto const& child: node)
+        {
+            encode(out, child.first);
+            encode(out, child.second);
+        }
+        break;
+    default:
+        put(out, null_node);
+        break;
+    }
+}
+
+struct decoder
+{
+    char const* p;
+    char const* const end;
+
+    template <class T>
+    T get()
+    {
+        T value;
+        take(&value, sizeof(value));
+        return value;
+    }
+
+    void take(void* const to, size_t const n)
+    {
+        if (size_t(end - p) < n)
+            throw bad_image("truncated");
+        std::memcpy(to, p, n);
+        p += n;
+    }
+
+    config_t node()
+    {
+        switch (get<node_kind>())
+        {
+        case null_node:
+            return config_t {YAML::NodeType::Null};
+        case scalar_node:
+        {
+            auto const size = get<uint32_t>();
+            if (size_t(end - p) < size)
+                throw bad_image("truncated");
+            config_t scalar {std::string {p, size}};
+            p += size;
+            return scalar;
+        }
+        case sequence_node:
+        {
+            config_t sequence {YAML::NodeType::Sequence};
+            for (auto n = get<uint32_t>(); n; --n)
+                sequence.push_back(node());
+            return sequence;
+        }
+        case map_node:
+        {
+            config_t map {YAML::NodeType::Map};
+            for (auto n = get<uint32_t>(); n; --n)
+            {
+                auto key = node();
+                map.force_insert(key, node());
+            }
+            return map;
+        }
+        }
+        throw bad_image("corrupt");
+    }
+};
+
+// read-only mapping of the whole file
+struct mapped_file
+{
+    explicit mapped_file(std::string const& path)
+    {
+        int const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return;
+
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void* const data = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                data_ = static_cast<char const*>(data);
+                size_ = size_t(st.st_size);
+            }
+        }
+        ::close(fd);
+    }
+
+    ~mapped_file()
+    {
+        if (data_)
+            ::munmap(const_cast<char*>(data_), size_);
+    }
+
+    mapped_file(mapped_file const&) = delete;
+    mapped_file& operator=(mapped_file const&) = delete;
+
+    char const* data_ {};
+    size_t size_ {};
+};
+
+} // local namespace
+
+void config_cache::write(config_t const& document, std::string const& source_path, std::string const& cache_path)
+{
+    auto const source = stamp(source_path);
+    if (!source)
+        throw fatal_error("cannot stat config " + source_path);
+
+    header h {};
+    std::memcpy(h.magic, magic, sizeof(magic));
+    h.source_mtime = source->mtime;
+    h.source_size = source->size;
+
+    std::string image;
+    put(image, h);
+    encode(image, document);
+
+    auto const tmp_path = cache_path + ".tmp";
+    {
+        std::ofstream out {tmp_path, std::ios::binary | std::ios::trunc};
+        out.write(image.data(), std::streamsize(image.size()));
+        if (!out.flush())
+            throw fatal_error("cannot write config cache " + tmp_path);
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, cache_path, ec);
+    if (ec)
+        throw fatal_error("cannot write config cache " + cache_path + ": " + ec.message());
+}
+
+std::optional<config_t> config_cache::read(std::string const& cache_path, std::string const& source_path)
+{
+    mapped_file const file {cache_path};
+    if (!file.data_)
+        return std::nullopt;
+
+    try
+    {
+        decoder in {file.data_, file.data_ + file.size_};
+        auto const h = in.get<header>();
+        if (std::memcmp(h.magic, magic, sizeof(magic)) != 0)
+            throw bad_image("not of this version");
+
+        auto const source = stamp(source_path);
+        if (!source || source->mtime != h.source_mtime || source->size != h.source_size)
+            return std::nullopt;
+
+        auto document = in.node();
+        if (in.p != in.end)
+            throw bad_image("corrupt");
+        return document;
+    }
+    catch (bad_image const& ex)
+    {
+        LOG_WRN << "ignoring config cache " << cache_path << ": " << ex.what();
+        return std::nullopt;
+    }
+}
+
+} // namespace ufw
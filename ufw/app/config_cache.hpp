@@ -0,0 +1,32 @@
+/* Copyright (c) 2026 Vladimir Lysyy (mrbald@github)
+ * ALv2 (http://www.apache.org/licenses/LICENSE-2.0)
+ */
+
+#pragma once
+
+#include "configuration.hpp"
+
+#include <optional>
+#include <string>
+
+namespace ufw {
+
+/**
+ * Binary image of a parsed YAML config document, for the launchers with large generated configs
+ * to skip the YAML parsing at startup (see `--config-cache` and `--compile-config`).
+ *
+ * The node tree is stored in the pre-order, length-prefixed, and read from the mmap-ed file straight
+ * into the nodes, with no text scanning. The tags and the styles are not kept, the loaders see the
+ * same values. The image records the size and the modification time of the source YAML and is only
+ * used while they match.
+ */
+struct config_cache
+{
+    // writes atomically (through a temporary file and a rename), throws fatal_error if it cannot
+    static void write(config_t const& document, std::string const& source_path, std::string const& cache_path);
+
+    // empty if there is no image, it is not of the current source, or it is broken (logged), the caller parses the YAML then
+    static std::optional<config_t> read(std::string const& cache_path, std::string const& source_path);
+};
+
+} // namespace ufw
@@ -26,17 +26,63 @@ namespace ufw {
 
 using config_t = YAML::Node;
 
+// lifecycle participant inbox, single_producer selects the cheaper SPSC enqueue
+struct inbox_config
+{
+    size_t capacity {1024};
+    bool single_producer {false};
+};
+
+/*
+ * type is one of
+ *   thread        - a dedicated thread
+ *   pinned_thread - a dedicated thread pinned to cpus[0]
+ *   thread_pool   - `threads` threads, optionally pinned round-robin to cpus
+ *   work_stealing - `threads` work-stealing workers, optionally pinned round-robin to cpus
+ *   strand        - serialized execution on top of the context_ref context
+ *   busy_poll     - a dedicated thread spinning on poll(), optionally pinned to cpus[0]
+ *
+ * busy_poll tuning: `pause` issues a CPU pause instruction after an empty poll,
+ * `yield_after` empty polls in a row the thread starts yielding (0 - never yields),
+ * non-zero `sched_fifo` raises the thread to SCHED_FIFO with that priority.
+ */
+struct execution_context_config
+{
+    std::string name;
+    std::string type;
+    size_t threads {1};
+    std::vector<int> cpus;
+    std::string context_ref;
+
+    bool pause {true};
+    size_t yield_after {0};
+    int sched_fifo {0};
+
+    int64_t handler_budget_us {0}; // overrides the application one if set, see application_config
+};
+
 struct entity_config
 {
     std::string name;
     std::string loader_ref;
+    std::string context_ref; // the main context if empty
+    std::vector<std::string> depends_on; // initialized and started after, stopped and deinitialized before these
+    std::string log_level; // trace, debug, info, warning, error or fatal, the global level if empty
+    inbox_config inbox;
 
     config_t config;
 };
 
 struct application_config
 {
+    std::vector<execution_context_config> execution_contexts;
     std::vector<entity_config> entities;
+    size_t bootstrap_threads {0}; // lifecycle stages of independent participants run in parallel on that many threads, 0 - sequentially
+
+    // queue wait and execution time histograms per execution context and per entity, see handler_monitor.hpp,
+    // a handler running over the budget (0 - none) is logged by the watchdog
+    bool instrument_handlers {false};
+    int64_t handler_budget_us {0};
 };
 
 } // namespace ufw
@@ -51,6 +97,66 @@ namespace CFG_NAMESPACE
 {
 
 
+template <>
+struct convert<ufw::inbox_config> {
+    static Node encode(const ufw::inbox_config& rhs) {
+        Node node;
+
+        CFG_ENCODE(capacity);
+        CFG_ENCODE(single_producer);
+
+        return node;
+    }
+
+    static bool decode(const Node& node, ufw::inbox_config& rhs)
+    {
+        if (!node.IsMap())
+            return false;
+
+        CFG_DECODE_IF_SET(capacity);
+        CFG_DECODE_IF_SET(single_producer);
+
+        return true;
+    }
+};
+
+template <>
+struct convert<ufw::execution_context_config> {
+    static Node encode(const ufw::execution_context_config& rhs) {
+        Node node;
+
+        CFG_ENCODE(name);
+        CFG_ENCODE(type);
+        CFG_ENCODE(threads);
+        CFG_ENCODE_IF_SET(cpus);
+        CFG_ENCODE_IF_SET(context_ref);
+        CFG_ENCODE(pause);
+        CFG_ENCODE(yield_after);
+        CFG_ENCODE(sched_fifo);
+        CFG_ENCODE(handler_budget_us);
+
+        return node;
+    }
+
+    static bool decode(const Node& node, ufw::execution_context_config& rhs)
+    {
+        if (!node.IsMap())
+            return false;
+
+        CFG_DECODE(name);
+        CFG_DECODE(type);
+        CFG_DECODE_IF_SET(threads);
+        CFG_DECODE_IF_SET(cpus);
+        CFG_DECODE_IF_SET(context_ref);
+        CFG_DECODE_IF_SET(pause);
+        CFG_DECODE_IF_SET(yield_after);
+        CFG_DECODE_IF_SET(sched_fifo);
+        CFG_DECODE_IF_SET(handler_budget_us);
+
+        return true;
+    }
+};
+
 template <>
 struct convert<ufw::entity_config> {
     static Node encode(const ufw::entity_config& rhs) {
@@ -58,6 +164,10 @@ struct convert<ufw::entity_config> {
 
         CFG_ENCODE(name);
         CFG_ENCODE_IF_SET(loader_ref);
+        CFG_ENCODE_IF_SET(context_ref);
+        CFG_ENCODE_IF_SET(depends_on);
+        CFG_ENCODE_IF_SET(log_level);
+        CFG_ENCODE(inbox);
         CFG_ENCODE(config);
 
         return node;
@@ -70,6 +180,10 @@ struct convert<ufw::entity_config> {
 
         CFG_DECODE(name);
         CFG_DECODE_IF_SET(loader_ref);
+        CFG_DECODE_IF_SET(context_ref);
+        CFG_DECODE_IF_SET(depends_on);
+        CFG_DECODE_IF_SET(log_level);
+        CFG_DECODE_IF_SET(inbox);
         CFG_DECODE_IF_SET(config);
 
         return true;
@@ -80,7 +194,11 @@ template <>
 struct convert<ufw::application_config> {
     static Node encode(const ufw::application_config& rhs) {
         Node node;
+        CFG_ENCODE_IF_SET(execution_contexts);
         CFG_ENCODE(entities);
+        CFG_ENCODE(bootstrap_threads);
+        CFG_ENCODE(instrument_handlers);
+        CFG_ENCODE(handler_budget_us);
         return node;
     }
 
@@ -88,7 +206,11 @@ struct convert<ufw::application_config> {
     {
         if (node.IsSequence())
             return false;
+        CFG_DECODE_IF_SET(execution_contexts);
         CFG_DECODE(entities);
+        CFG_DECODE_IF_SET(bootstrap_threads);
+        CFG_DECODE_IF_SET(instrument_handlers);
+        CFG_DECODE_IF_SET(handler_budget_us);
         return true;
     }
 };
@@ -6,6 +6,7 @@
 #pragma once
 
 #include "logger.hpp"
+#include "metrics.hpp"
 
 #include <string>
 
@@ -16,6 +17,7 @@ using resolved_entity_id = size_t;
 
 struct application;
 struct lifecycle_participant;
+struct execution_context;
 
 #define ENTITY_LOGGER \
 private:\
@@ -25,8 +27,11 @@ private:\
         logger.add_attribute("Entity", attrs::constant<entity_id>(id()));\
         return logger;\
     }()};\
+    ::ufw::log_source log_source_ {::ufw::intern_log_name(id())};\
 public:\
-    logger_t& get_logger() const { return logger_; }
+    logger_t& get_logger() const { return logger_; }\
+    ::ufw::log_source const& get_log_source() const { return log_source_; }\
+    void set_log_level(logging::trivial::severity_level level) { log_source_.level.store(int(level), std::memory_order_relaxed); }
 
 struct entity
 {
@@ -39,6 +44,14 @@ struct entity
 
     application& app() const noexcept { return app_; }
 
+    // the execution context the entity is bound to in the config, the main context by default
+    execution_context& context() const;
+
+    // "<entity ID>.<name>" metrics in the application registry, see metrics.hpp
+    ufw::counter make_counter(std::string const& name) const;
+    ufw::gauge make_gauge(std::string const& name) const;
+    ufw::histogram make_histogram(std::string const& name) const;
+
 private:
     entity_id const id_;
     resolved_entity_id const rid_;
@@ -48,26 +61,50 @@ private:
     friend struct lifecycle_participant; // logger access
 };
 
+/**
+ * Resolved typed entity reference, obtained with application::handle<T>(),
+ * costs a single pointer load to dereference.
+ */
+template <class T>
+struct entity_handle
+{
+    entity_handle() = default;
+    entity_handle(T& target, resolved_entity_id rid) noexcept: target_ {&target}, rid_ {rid} {}
+
+    T* operator->() const noexcept { return target_; }
+    T& operator*() const noexcept { return *target_; }
+    T* get() const noexcept { return target_; }
+
+    explicit operator bool() const noexcept { return target_; }
+
+    resolved_entity_id resolved_id() const noexcept { return rid_; }
+
+private:
+    T* target_ {};
+    resolved_entity_id rid_ = -1;
+};
+
 /**
  * Entity lazy references logic helper
  */
 template <class T>
 struct entity_ref
 {
-    T* operator->() const { return target_; }
-    T* get() const { return target_; }
+    T* operator->() const { return handle_.get(); }
+    T* get() const { return handle_.get(); }
 
-    explicit operator T&() { return *target_; }
-    explicit operator T const&() const { return *target_; }
+    explicit operator T&() { return *handle_; }
+    explicit operator T const&() const { return *handle_; }
 
-    explicit operator bool() const { return target_; }
+    explicit operator bool() const { return bool(handle_); }
 
-    entity_ref(entity_id const& id, application& app):
-            id_ {id},
-            app_ {app} {}
+    // a reference made while an entity is being loaded makes it depend on the target in the lifecycle stages
+    entity_ref(entity_id const& id, application& app);
 
     entity_id const& id() { return id_; }
-    resolved_entity_id resolved_id() const { return resolved_id_; }
+    resolved_entity_id resolved_id() const { return handle_.resolved_id(); }
+
+    entity_handle<T> const& handle() const { return handle_; }
 
     void resolve();
 
@@ -75,8 +112,7 @@ private:
     entity_id const id_;
     application& app_;
 
-    resolved_entity_id resolved_id_;
-    T* target_ {};
+    entity_handle<T> handle_;
 };
 
 } // namespace ufw
@@ -1,6 +1,7 @@
 #include "entity.hpp"
 #include "lifecycle_participant.hpp"
 #include "application.hpp"
+#include "static_plugins.hpp"
 
 #include <boost/asio/steady_timer.hpp>
 
@@ -10,7 +11,7 @@ struct example: ufw::entity, ufw::lifecycle_participant {
     template<class... Args>
     example(Args&&... args):
         entity { std::forward<Args>(args)... },
-        timer_ { app().context() }
+        timer_ { context().get_executor() }
     {
     }
 
@@ -22,13 +23,13 @@ struct example: ufw::entity, ufw::lifecycle_participant {
     void start() override /* from lifecycle_participant */
     {
         LOG_INF << "started";
-        app().context().post([this]{
+        app().post(*this, [this]{
             LOG_INF << "scheduling shutdown in 5 seconds";
             timer_.expires_after(std::chrono::seconds(5));
-            timer_.async_wait([this](auto&&){
+            timer_.async_wait(ufw::recycling([this](auto&&){
                 LOG_INF << ">>>>>> shutting down <<<<<<";
                 app().shutdown();
-            });
+            }));
         });
     }
 
@@ -50,4 +51,6 @@ extern "C" ufw::entity* example_ctor(ufw::entity_id const& id, ufw::resolved_ent
     return new example {id, rid, app};
 }
 
+UFW_STATIC_PLUGIN(example, example_ctor);
+
 } // local namespace
@@ -0,0 +1,302 @@
+#include "execution_context.hpp"
+
+#include "entity.hpp"
+#include "exception_types.hpp"
+#include "logger.hpp"
+#include "work_stealing_pool.hpp"
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/strand.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace ufw {
+
+bool pin_current_thread(int const cpu) noexcept
+{
+#ifdef __linux__
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return !pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+bool set_current_thread_fifo(int const priority) noexcept
+{
+    sched_param param {};
+    param.sched_priority = priority;
+    return !pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+}
+
+namespace {
+
+struct main_context final: execution_context
+{
+    main_context(std::string name, boost::asio::io_context& context):
+        execution_context {std::move(name)},
+        context_ {context} {}
+
+    executor_type get_executor() noexcept override { return context_.get_executor(); }
+
+    void post(task t) override { boost::asio::post(context_.get_executor(), recycling(std::move(t))); }
+
+private:
+    boost::asio::io_context& context_;
+};
+
+/*
+ * An io_context run by one or more dedicated threads, optionally pinned to CPUs
+ * (thread i is pinned to cpus[i % cpus.size()]).
+ */
+struct thread_context final: execution_context
+{
+    thread_context(execution_context_config const& cfg, execution_context_error_handler_t on_error):
+        execution_context {cfg.name},
+        threads_count_ {cfg.threads},
+        cpus_ {cfg.cpus},
+        on_error_ {std::move(on_error)},
+        context_ {int(cfg.threads)}
+    {
+        if (!threads_count_)
+            throw fatal_error("execution context " + name() + " needs at least one thread");
+    }
+
+    ~thread_context() override { stop(); }
+
+    executor_type get_executor() noexcept override { return context_.get_executor(); }
+
+    void post(task t) override { boost::asio::post(context_.get_executor(), recycling(std::move(t))); }
+
+    void start() override
+    {
+        for (size_t i = 0; i < threads_count_; ++i)
+            threads_.emplace_back([this, i] { run(i); });
+    }
+
+    void stop() noexcept override
+    {
+        work_.reset();
+        context_.stop();
+        for (auto& t: threads_)
+            if (t.joinable()) t.join();
+        threads_.clear();
+    }
+
+private:
+    entity_id id() const { return name(); } // for ENTITY_LOGGER macro to work
+
+    void run(size_t const i)
+    {
+        LOG_STAMP_THREAD;
+
+        if (!cpus_.empty())
+        {
+            auto const cpu = cpus_[i % cpus_.size()];
+            if (pin_current_thread(cpu))
+                LOG_INF << "thread " << i << " pinned to CPU " << cpu;
+            else
+                LOG_WRN << "failed to pin thread " << i << " to CPU " << cpu;
+        }
+
+        try
+        {
+            context_.run();
+        }
+        catch (std::exception const& e)
+        {
+            LOG_ERR << "unhandled exception in thread " << i << ": " << e.what();
+            if (on_error_) on_error_(*this);
+        }
+    }
+
+    size_t const threads_count_;
+    std::vector<int> const cpus_;
+    execution_context_error_handler_t const on_error_;
+
+    boost::asio::io_context context_;
+    std::unique_ptr<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> work_ {
+        std::make_unique<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>>(context_.get_executor())};
+    std::vector<std::thread> threads_;
+
+    ENTITY_LOGGER;
+};
+
+/*
+ * A dedicated thread spinning on io_context::poll() to avoid the wake-up latency of
+ * blocking in epoll/kqueue, trading a fully busy CPU for it.
+ */
+struct busy_poll_context final: execution_context
+{
+    busy_poll_context(execution_context_config const& cfg, execution_context_error_handler_t on_error):
+        execution_context {cfg.name},
+        cpu_ {cfg.cpus.empty() ? -1 : cfg.cpus.front()},
+        pause_ {cfg.pause},
+        yield_after_ {cfg.yield_after},
+        sched_fifo_ {cfg.sched_fifo},
+        on_error_ {std::move(on_error)} {}
+
+    ~busy_poll_context() override { stop(); }
+
+    executor_type get_executor() noexcept override { return context_.get_executor(); }
+
+    void post(task t) override { boost::asio::post(context_.get_executor(), recycling(std::move(t))); }
+
+    void start() override
+    {
+        stopped_.store(false, std::memory_order_relaxed);
+        thread_ = std::thread {[this] { run(); }};
+    }
+
+    void stop() noexcept override
+    {
+        stopped_.store(true, std::memory_order_relaxed);
+        if (thread_.joinable()) thread_.join();
+    }
+
+private:
+    std::string id() const { return name(); } // for ENTITY_LOGGER macro to work
+
+    void run()
+    {
+        LOG_STAMP_THREAD;
+
+        if (cpu_ >= 0)
+        {
+            if (pin_current_thread(cpu_))
+                LOG_INF << "pinned to CPU " << cpu_;
+            else
+                LOG_WRN << "failed to pin to CPU " << cpu_;
+        }
+
+        if (sched_fifo_)
+        {
+            if (set_current_thread_fifo(sched_fifo_))
+                LOG_INF << "raised to SCHED_FIFO priority " << sched_fifo_;
+            else
+                LOG_WRN << "failed to raise to SCHED_FIFO priority " << sched_fifo_;
+        }
+
+        try
+        {
+            size_t idle = 0;
+            while (!stopped_.load(std::memory_order_relaxed))
+            {
+                if (context_.poll())
+                {
+                    idle = 0;
+                    continue;
+                }
+
+                if (yield_after_ && ++idle >= yield_after_)
+                    std::this_thread::yield();
+                else if (pause_)
+                    cpu_relax();
+            }
+        }
+        catch (std::exception const& e)
+        {
+            LOG_ERR << "unhandled exception: " << e.what();
+            if (on_error_) on_error_(*this);
+        }
+    }
+
+    int const cpu_;
+    bool const pause_;
+    size_t const yield_after_;
+    int const sched_fifo_;
+    execution_context_error_handler_t const on_error_;
+
+    boost::asio::io_context context_ {1};
+    boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work_ {context_.get_executor()}; // keeps poll() from stopping the context
+    std::atomic<bool> stopped_ {true};
+    std::thread thread_;
+
+    ENTITY_LOGGER;
+};
+
+/*
+ * A work_stealing_pool, for fan-out workloads of many short tasks where a shared
+ * io_context run by many threads contends on its queue lock.
+ */
+struct work_stealing_context final: execution_context
+{
+    work_stealing_context(execution_context_config const& cfg, execution_context_error_handler_t on_error):
+        execution_context {cfg.name},
+        pool_ {cfg.threads, cfg.cpus, [this, on_error = std::move(on_error)](std::exception_ptr) {
+            if (on_error) on_error(*this);
+        }} {}
+
+    ~work_stealing_context() override { stop(); }
+
+    executor_type get_executor() noexcept override { return pool_.get_executor(); }
+
+    void post(task t) override { pool_.submit(std::move(t)); }
+
+    void start() override { pool_.start(); }
+    void stop() noexcept override { pool_.stop(); }
+
+private:
+    work_stealing_pool pool_;
+};
+
+struct strand_context final: execution_context
+{
+    strand_context(std::string name, execution_context& target):
+        execution_context {std::move(name)},
+        strand_ {boost::asio::make_strand(target.get_executor())} {}
+
+    executor_type get_executor() noexcept override { return strand_; }
+
+private:
+    boost::asio::strand<executor_type> strand_;
+};
+
+} // local namespace
+
+std::unique_ptr<execution_context> make_main_context(std::string name, boost::asio::io_context& context)
+{
+    return std::make_unique<main_context>(std::move(name), context);
+}
+
+std::unique_ptr<execution_context> make_execution_context(execution_context_config const& cfg,
+        execution_context_error_handler_t on_error)
+{
+    if (cfg.type == "thread_pool")
+        return std::make_unique<thread_context>(cfg, std::move(on_error));
+
+    if (cfg.type == "work_stealing")
+        return std::make_unique<work_stealing_context>(cfg, std::move(on_error));
+
+    if (cfg.type == "busy_poll")
+        return std::make_unique<busy_poll_context>(cfg, std::move(on_error));
+
+    if (cfg.type == "thread" || cfg.type == "pinned_thread")
+    {
+        if (cfg.type == "pinned_thread" && cfg.cpus.empty())
+            throw fatal_error("pinned_thread execution context " + cfg.name + " needs cpus");
+
+        auto single = cfg;
+        single.threads = 1;
+        return std::make_unique<thread_context>(single, std::move(on_error));
+    }
+
+    throw fatal_error("unknown execution context type " + cfg.type + " for " + cfg.name);
+}
+
+std::unique_ptr<execution_context> make_strand_context(std::string name, execution_context& target)
+{
+    return std::make_unique<strand_context>(std::move(name), target);
+}
+
+} // namespace ufw
@@ -0,0 +1,113 @@
+/* Copyright (c) 2026 Vladimir Lysyy (mrbald@github)
+ * ALv2 (http://www.apache.org/licenses/LICENSE-2.0)
+ */
+
+#pragma once
+
+#include "configuration.hpp"
+#include "handler_memory.hpp"
+#include "handler_monitor.hpp"
+#include "task.hpp"
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace ufw {
+
+/**
+ * Execution context - a set of rules for code execution entities can be bound to
+ * in the config (a dedicated thread, a thread pool, a strand on a thread pool, ...).
+ *
+ * start() spawns the threads, if any, stop() stops and joins them. Both are called
+ * by the application, around the main context run.
+ */
+struct execution_context
+{
+    using executor_type = boost::asio::any_io_executor;
+
+    explicit execution_context(std::string name): name_ {std::move(name)} {}
+    virtual ~execution_context() = default;
+
+    execution_context(execution_context const&) = delete;
+    execution_context& operator=(execution_context const&) = delete;
+
+    std::string const& name() const noexcept { return name_; }
+
+    virtual executor_type get_executor() noexcept = 0;
+
+    virtual void start() {}
+    virtual void stop() noexcept {}
+
+    template <class F>
+    void post(F&& f)
+    {
+        if (stats_)
+            post(task {timed(std::forward<F>(f))});
+        else
+            post(task {std::forward<F>(f)});
+    }
+
+    // the io_context based contexts override it to post to the concrete executor, bypassing the
+    // executor type erasure, which allocates, and taking the operation memory from handler_memory
+    virtual void post(task t) { boost::asio::post(get_executor(), recycling(std::move(t))); }
+
+    // the handler queue wait and execution times if the context is instrumented, for the completion
+    // handlers the framework does not post itself, e.g. `timer.async_wait(recycling(context.timed(h, timer.expiry())))`
+    template <class F>
+    timed_handler<std::decay_t<F>> timed(F&& f, int64_t const due_ns = tsc_clock::monotonic_ns())
+    {
+        return {stats_.get(), due_ns, std::forward<F>(f)};
+    }
+
+    template <class F, class Clock, class Duration>
+    timed_handler<std::decay_t<F>> timed(F&& f, std::chrono::time_point<Clock, Duration> const due)
+    {
+        auto const ahead = std::chrono::duration_cast<std::chrono::nanoseconds>(due - Clock::now()).count();
+        return timed(std::forward<F>(f), tsc_clock::monotonic_ns() + ahead);
+    }
+
+    // set by the application with instrument_handlers on
+    void instrument(std::shared_ptr<handler_stats> stats) noexcept { stats_ = std::move(stats); }
+    handler_stats* stats() const noexcept { return stats_.get(); }
+
+private:
+    std::string const name_;
+    std::shared_ptr<handler_stats> stats_;
+};
+
+// called on a context thread if a handler throws, the thread exits afterwards
+using execution_context_error_handler_t = std::function<void(execution_context&)>;
+
+// the application main context, run by the application main thread
+std::unique_ptr<execution_context> make_main_context(std::string name, boost::asio::io_context& context);
+
+// thread, pinned_thread, thread_pool, work_stealing and busy_poll types from the config, strands are made with make_strand_context()
+std::unique_ptr<execution_context> make_execution_context(execution_context_config const& cfg,
+        execution_context_error_handler_t on_error);
+
+std::unique_ptr<execution_context> make_strand_context(std::string name, execution_context& target);
+
+// Linux only, a no-op elsewhere, true on success
+bool pin_current_thread(int cpu) noexcept;
+
+// true on success, usually needs CAP_SYS_NICE
+bool set_current_thread_fifo(int priority) noexcept;
+
+// spin-wait hint to the CPU
+inline void cpu_relax() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+} // namespace ufw
@@ -0,0 +1,154 @@
+#include "handler_memory.hpp"
+
+#include <atomic>
+#include <bit>
+#include <new>
+
+namespace ufw {
+
+namespace {
+
+constexpr size_t size_classes = std::countr_zero(handler_memory::max_block_size / handler_memory::min_block_size) + 1;
+constexpr size_t max_cached_blocks = 256; // per size class per thread, the excess goes back to the heap
+
+struct thread_cache;
+
+struct block
+{
+    block* next;
+};
+
+// in front of every pooled block, keeps the blocks max_align_t aligned
+struct alignas(std::max_align_t) block_header
+{
+    thread_cache* owner;
+};
+
+struct thread_cache
+{
+    // on the owner thread exit, a block freed elsewhere concurrently may still slip into the remote list and leak
+    void orphan() noexcept
+    {
+        orphaned.store(true, std::memory_order_seq_cst);
+        for (size_t c = 0; c < size_classes; ++c)
+        {
+            release(local[c]);
+            release(remote[c].exchange(nullptr, std::memory_order_acquire));
+        }
+    }
+
+    // takes the blocks freed elsewhere into the empty local list, counted, past the cap to the heap
+    block* adopt(size_t const c) noexcept
+    {
+        block* b = remote[c].exchange(nullptr, std::memory_order_acquire);
+        block** tail = &local[c];
+        for (; b && local_count[c] < max_cached_blocks; b = b->next, ++local_count[c])
+        {
+            *tail = b;
+            tail = &b->next;
+        }
+        *tail = nullptr;
+        release(b);
+        return local[c];
+    }
+
+    static void release(block* b) noexcept
+    {
+        while (b)
+        {
+            auto* const next = b->next;
+            ::operator delete(b);
+            b = next;
+        }
+    }
+
+    block* local[size_classes] {};
+    size_t local_count[size_classes] {};
+    std::atomic<block*> remote[size_classes] {};
+    std::atomic<bool> orphaned {false};
+};
+
+// never destroyed, blocks freed on other threads after the owner exit still find it
+thread_cache& local_cache()
+{
+    struct holder
+    {
+        thread_cache* cache {new thread_cache};
+        ~holder() { cache->orphan(); }
+    };
+    thread_local holder h;
+    return *h.cache;
+}
+
+size_t size_class(size_t const size) noexcept
+{
+    return size <= handler_memory::min_block_size ? 0 : std::bit_width(size - 1) - std::countr_zero(handler_memory::min_block_size);
+}
+
+} // local namespace
+
+void* handler_memory::allocate(size_t const size)
+{
+    if (size > max_block_size)
+        return ::operator new(size);
+
+    auto const c = size_class(size);
+    auto& cache = local_cache();
+
+    block* b = cache.local[c];
+    if (!b)
+        b = cache.adopt(c);
+
+    void* raw;
+    if (b)
+    {
+        cache.local[c] = b->next;
+        --cache.local_count[c];
+        raw = b;
+    }
+    else
+        raw = ::operator new(sizeof(block_header) + (min_block_size << c));
+
+    auto* const header = ::new (raw) block_header {&cache};
+    return header + 1;
+}
+
+void handler_memory::deallocate(void* const p, size_t const size) noexcept
+{
+    if (size > max_block_size)
+    {
+        ::operator delete(p);
+        return;
+    }
+
+    auto const c = size_class(size);
+    auto* const header = static_cast<block_header*>(p) - 1;
+    thread_cache* const owner = header->owner;
+    auto* const b = reinterpret_cast<block*>(header);
+
+    auto& cache = local_cache();
+    if (owner == &cache)
+    {
+        if (cache.local_count[c] >= max_cached_blocks)
+        {
+            ::operator delete(b);
+            return;
+        }
+        b->next = cache.local[c];
+        cache.local[c] = b;
+        ++cache.local_count[c];
+        return;
+    }
+
+    if (owner->orphaned.load(std::memory_order_seq_cst))
+    {
+        ::operator delete(b);
+        return;
+    }
+
+    // push only, the owner takes the whole list at once, so no ABA
+    b->next = owner->remote[c].load(std::memory_order_relaxed);
+    while (!owner->remote[c].compare_exchange_weak(b->next, b, std::memory_order_release, std::memory_order_relaxed));
+}
+
+} // namespace ufw
@@ -0,0 +1,95 @@
+/* Copyright (c) 2026 Vladimir Lysyy (mrbald@github)
+ * ALv2 (http://www.apache.org/licenses/LICENSE-2.0)
+ */
+
+#pragma once
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/associated_executor.hpp>
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace ufw {
+
+/**
+ * Handler memory recycling - per-thread free lists in power of two size classes
+ * from min_block_size to max_block_size, larger blocks go to the global heap.
+ *
+ * A block remembers the thread cache it came from. Freed on that thread it goes on the
+ * local free list, freed elsewhere it is pushed to the owner lock-free "remote" list
+ * the owner picks up once its local list runs dry, so that posting from one thread to
+ * another recycles too.
+ */
+struct handler_memory
+{
+    static constexpr size_t min_block_size = 64;
+    static constexpr size_t max_block_size = 1024;
+
+    static void* allocate(size_t size);
+    static void deallocate(void* p, size_t size) noexcept;
+};
+
+template <class T>
+struct handler_allocator
+{
+    using value_type = T;
+
+    handler_allocator() noexcept = default;
+
+    template <class U>
+    handler_allocator(handler_allocator<U> const&) noexcept {}
+
+    T* allocate(size_t const n) { return static_cast<T*>(handler_memory::allocate(n * sizeof(T))); }
+    void deallocate(T* const p, size_t const n) noexcept { handler_memory::deallocate(p, n * sizeof(T)); }
+
+    template <class U>
+    bool operator==(handler_allocator<U> const&) const noexcept { return true; }
+
+    template <class U>
+    bool operator!=(handler_allocator<U> const&) const noexcept { return false; }
+};
+
+/**
+ * A handler with handler_allocator as its associated allocator, asio allocates the operation
+ * wrapping the handler (a posted function, a timer wait, ...) from the recycled memory.
+ */
+template <class Handler>
+struct recycling_handler
+{
+    using allocator_type = handler_allocator<void>;
+
+    template <class H>
+    explicit recycling_handler(H&& handler): handler_ {std::forward<H>(handler)} {}
+
+    allocator_type get_allocator() const noexcept { return {}; }
+
+    template <class... Args>
+    decltype(auto) operator()(Args&&... args) { return handler_(std::forward<Args>(args)...); }
+
+    Handler handler_;
+};
+
+template <class Handler>
+recycling_handler<std::decay_t<Handler>> recycling(Handler&& handler)
+{
+    return recycling_handler<std::decay_t<Handler>> {std::forward<Handler>(handler)};
+}
+
+} // namespace ufw
+
+namespace boost::asio {
+
+template <class Handler, class Executor>
+struct associated_executor<ufw::recycling_handler<Handler>, Executor>
+{
+    using type = associated_executor_t<Handler, Executor>;
+
+    static type get(ufw::recycling_handler<Handler> const& h, Executor const& ex = Executor()) noexcept
+    {
+        return get_associated_executor(h.handler_, ex);
+    }
+};
+
+} // namespace boost::asio
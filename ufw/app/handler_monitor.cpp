@@ -0,0 +1,164 @@
+#include "handler_monitor.hpp"
+
+#include "logger.hpp"
+
+#include <boost/core/demangle.hpp>
+
+#include <algorithm>
+
+namespace ufw {
+
+namespace {
+
+std::atomic<uint64_t> last_monitor_id {0};
+
+} // local namespace
+
+handler_stats::handler_stats(handler_monitor& monitor, std::string scope, int64_t const budget_ns):
+    monitor {monitor},
+    scope {std::move(scope)},
+    budget_ns {budget_ns},
+    queue_wait {monitor.metrics_.histogram(this->scope + ".queue_wait_ns")},
+    execution {monitor.metrics_.histogram(this->scope + ".execution_ns")}
+{
+}
+
+handler_monitor::handler_monitor(metrics_registry& metrics):
+    metrics_ {metrics},
+    id_ {++last_monitor_id}
+{
+}
+
+handler_monitor::~handler_monitor()
+{
+    {
+        std::lock_guard<std::mutex> lock {mutex_};
+        stopped_ = true;
+    }
+    wakeup_.notify_one();
+    if (watchdog_.joinable())
+        watchdog_.join();
+}
+
+std::shared_ptr<handler_stats> handler_monitor::make_stats(std::string const& scope, int64_t const budget_ns)
+{
+    auto stats = std::make_shared<handler_stats>(*this, scope, budget_ns);
+
+    std::lock_guard<std::mutex> lock {mutex_};
+    stats_.push_back(stats);
+
+    if (budget_ns > 0)
+    {
+        // a quarter of the tightest budget, but not busier than every millisecond
+        auto const period_ns = std::max<int64_t>(budget_ns / 4, 1'000'000);
+        if (!watch_period_ns_ || period_ns < watch_period_ns_)
+            watch_period_ns_ = period_ns;
+        if (!watchdog_.joinable())
+            watchdog_ = std::thread {[this] { watch(); }};
+    }
+
+    return stats;
+}
+
+std::vector<handler_monitor::slow_handler> handler_monitor::slowest() const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    return slowest_;
+}
+
+handler_monitor::running_slot& handler_monitor::attach()
+{
+    // reused when the thread comes back from another monitor, as metrics_registry::attach() does
+    thread_local std::vector<std::pair<uint64_t, running_slot*>> attached;
+    for (auto const& [monitor_id, slot]: attached)
+        if (monitor_id == id_)
+            return *slot;
+
+    std::lock_guard<std::mutex> lock {mutex_};
+    slots_.push_back(std::make_unique<running_slot>());
+    attached.emplace_back(id_, slots_.back().get());
+    return *slots_.back();
+}
+
+void handler_monitor::finished(handler_stats const& stats, char const* const label, int64_t const execution_ns, bool const reported) noexcept
+{
+    try
+    {
+        // once per handler, here if the watchdog did not catch it running, throttled for a context slow all the time
+        if (stats.budget_ns && execution_ns > stats.budget_ns && !reported)
+        {
+            LOG_WRN_RATE_LIMITED(10, 10) << "watchdog: " << boost::core::demangle(label)
+                << " in " << stats.scope << " took " << execution_ns / 1000 << " us, the budget is " << stats.budget_ns / 1000 << " us";
+        }
+
+        if (execution_ns <= slowest_threshold_.load(std::memory_order_relaxed))
+            return;
+
+        std::lock_guard<std::mutex> lock {mutex_};
+
+        auto const it = std::find_if(slowest_.begin(), slowest_.end(),
+                [&](slow_handler const& x) { return x.execution_ns < execution_ns; });
+        slowest_.insert(it, {stats.scope, boost::core::demangle(label), execution_ns, tsc_clock::wall_ns()});
+
+        if (slowest_.size() > slowest_size)
+            slowest_.pop_back();
+        if (slowest_.size() == slowest_size)
+            slowest_threshold_.store(slowest_.back().execution_ns, std::memory_order_relaxed);
+    }
+    catch (...)
+    {
+        // the handler is over, losing its stats is fine
+    }
+}
+
+void handler_monitor::watch()
+{
+    struct overrun
+    {
+        handler_stats const* stats;
+        char const* label;
+        int64_t running_ns;
+    };
+    std::vector<overrun> overruns;
+
+    std::unique_lock<std::mutex> lock {mutex_};
+
+    while (!stopped_)
+    {
+        wakeup_.wait_for(lock, std::chrono::nanoseconds(watch_period_ns_));
+
+        auto const now = tsc_clock::monotonic_ns();
+        for (auto const& slot: slots_)
+        {
+            auto const since = slot->since_ns.load(std::memory_order_acquire);
+            if (!since)
+                continue;
+
+            auto const* const stats = slot->stats.load(std::memory_order_relaxed);
+            auto const* const label = slot->label.load(std::memory_order_relaxed);
+            if (!stats || !stats->budget_ns || now - since <= stats->budget_ns)
+                continue;
+
+            // the thread may have moved on since, best effort
+            if (slot->since_ns.load(std::memory_order_acquire) != since || slot->reported.exchange(true))
+                continue;
+
+            overruns.push_back({stats, label, now - since});
+        }
+
+        if (overruns.empty())
+            continue;
+
+        // the stats live as long as the monitor, the handlers finishing meanwhile are not waiting for the log
+        lock.unlock();
+        for (auto const& x: overruns)
+        {
+            LOG_WRN_RATE_LIMITED(10, 10) << "watchdog: " << boost::core::demangle(x.label) << " in " << x.stats->scope
+                << " is running for " << x.running_ns / 1000 << " us, the budget is " << x.stats->budget_ns / 1000 << " us";
+        }
+        overruns.clear();
+        lock.lock();
+    }
+}
+
+} // namespace ufw
@@ -0,0 +1,186 @@
+/* Copyright (c) 2026 Vladimir Lysyy (mrbald@github)
+ * ALv2 (http://www.apache.org/licenses/LICENSE-2.0)
+ */
+
+#pragma once
+
+#include "clock.hpp"
+#include "metrics.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+namespace ufw {
+
+struct handler_monitor;
+
+/**
+ * Queue wait and execution time of the handlers of one scope - an execution context or an entity,
+ * as `<scope>.queue_wait_ns` and `<scope>.execution_ns` histograms. A handler running longer than
+ * the budget (0 - no budget) is reported once, by the watchdog while still running, or when over if
+ * missed by the watchdog.
+ */
+struct handler_stats
+{
+    handler_stats(handler_monitor& monitor, std::string scope, int64_t budget_ns);
+
+    // the label is a type name, demangled when reported
+    template <class F, class... Args>
+    void run(F& f, int64_t enqueued_ns, char const* label, Args&&... args);
+
+    handler_monitor& monitor;
+    std::string const scope;
+    int64_t const budget_ns;
+    histogram const queue_wait;
+    histogram const execution;
+};
+
+/**
+ * A handler timed against the stats, if any, the queue wait counts from `due_ns`
+ * (tsc_clock::monotonic_ns()) - the post or the timer expiry time.
+ */
+template <class F>
+struct timed_handler
+{
+    template <class... Args>
+    void operator()(Args&&... args)
+    {
+        if (stats_)
+            stats_->run(f_, due_ns_, typeid(F).name(), std::forward<Args>(args)...);
+        else
+            f_(std::forward<Args>(args)...);
+    }
+
+    handler_stats* stats_;
+    int64_t due_ns_;
+    F f_;
+};
+
+/**
+ * The application-wide part of the handler instrumentation - the slowest handlers table and the
+ * watchdog thread, started with the first stats having a budget, that scans what every thread
+ * is running.
+ */
+struct handler_monitor
+{
+    static constexpr size_t slowest_size = 16;
+
+    struct slow_handler
+    {
+        std::string scope;
+        std::string label; // demangled
+        int64_t execution_ns;
+        int64_t wall_ns; // when it finished
+    };
+
+    explicit handler_monitor(metrics_registry& metrics);
+    ~handler_monitor();
+
+    handler_monitor(handler_monitor const&) = delete;
+    handler_monitor& operator=(handler_monitor const&) = delete;
+
+    std::shared_ptr<handler_stats> make_stats(std::string const& scope, int64_t budget_ns);
+
+    // the slowest first
+    std::vector<slow_handler> slowest() const;
+
+private:
+    friend struct handler_stats;
+
+    // what a thread is running, written by the thread, scanned by the watchdog
+    struct running_slot
+    {
+        std::atomic<int64_t> since_ns {0}; // 0 - idle
+        std::atomic<handler_stats const*> stats {nullptr};
+        std::atomic<char const*> label {nullptr};
+        std::atomic<bool> reported {false};
+    };
+
+    running_slot& local_slot()
+    {
+        thread_local struct { uint64_t monitor_id; running_slot* slot; } cache {};
+        if (cache.monitor_id != id_) [[unlikely]]
+            cache = {id_, &attach()};
+        return *cache.slot;
+    }
+
+    running_slot& attach();
+    void finished(handler_stats const& stats, char const* label, int64_t execution_ns, bool reported) noexcept;
+    void watch();
+
+    metrics_registry& metrics_;
+    uint64_t const id_;
+
+    mutable std::mutex mutex_;
+    std::vector<std::shared_ptr<handler_stats>> stats_;
+    std::vector<std::unique_ptr<running_slot>> slots_;
+    std::vector<slow_handler> slowest_; // the slowest first, up to slowest_size
+    std::atomic<int64_t> slowest_threshold_ {0}; // to get in once the table is full
+
+    std::condition_variable wakeup_;
+    int64_t watch_period_ns_ {0}; // 0 - no watchdog
+    bool stopped_ {false};
+    std::thread watchdog_;
+};
+
+template <class F, class... Args>
+void handler_stats::run(F& f, int64_t const enqueued_ns, char const* const label, Args&&... args)
+{
+    auto& slot = monitor.local_slot();
+
+    // handlers may nest (an inbox drain runs the entity messages), the outer one is restored after
+    auto const outer_since = slot.since_ns.load(std::memory_order_relaxed);
+    auto const* const outer_stats = slot.stats.load(std::memory_order_relaxed);
+    auto const* const outer_label = slot.label.load(std::memory_order_relaxed);
+    auto const outer_reported = slot.reported.load(std::memory_order_relaxed);
+
+    auto const start = tsc_clock::monotonic_ns();
+    slot.stats.store(this, std::memory_order_relaxed);
+    slot.label.store(label, std::memory_order_relaxed);
+    slot.reported.store(false, std::memory_order_relaxed);
+    slot.since_ns.store(start, std::memory_order_release);
+
+    struct restore
+    {
+        ~restore()
+        {
+            auto const end = tsc_clock::monotonic_ns();
+            self.execution.record(uint64_t(end - start));
+            auto const reported = slot.reported.load(std::memory_order_relaxed);
+
+            slot.since_ns.store(0, std::memory_order_relaxed);
+            slot.stats.store(outer_stats, std::memory_order_relaxed);
+            slot.label.store(outer_label, std::memory_order_relaxed);
+            slot.reported.store(outer_reported, std::memory_order_relaxed);
+            slot.since_ns.store(outer_since, std::memory_order_release);
+
+            self.monitor.finished(self, label, end - start, reported);
+        }
+
+        handler_stats const& self;
+        handler_monitor::running_slot& slot;
+        int64_t const start;
+        int64_t const outer_since;
+        handler_stats const* const outer_stats;
+        char const* const outer_label;
+        bool const outer_reported;
+        char const* const label;
+    } const guard {*this, slot, start, outer_since, outer_stats, outer_label, outer_reported, label};
+
+    queue_wait.record(uint64_t(std::max<int64_t>(0, start - enqueued_ns)));
+    UFW_TRACE_SCOPE(label, scope.c_str(), true);
+    f(std::forward<Args>(args)...);
+}
+
+} // namespace ufw
@@ -0,0 +1,178 @@
+/* Copyright (c) 2026 Vladimir Lysyy (mrbald@github)
+ * ALv2 (http://www.apache.org/licenses/LICENSE-2.0)
+ */
+
+#pragma once
+
+#include "task.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace ufw {
+
+constexpr size_t cache_line_size = 64;
+
+/**
+ * Bounded lock-free queue with a single consumer and one or many producers.
+ *
+ * Cells carry sequence numbers (D. Vyukov's bounded queue), the producer and the
+ * consumer indices live on separate cache lines. With a single producer the tail
+ * is advanced with a plain store instead of a CAS.
+ */
+template <class T>
+struct ring
+{
+    ring(size_t capacity, bool single_producer):
+        mask_ {std::bit_ceil(std::max<size_t>(capacity, 2)) - 1},
+        single_producer_ {single_producer},
+        cells_ {new cell[mask_ + 1]}
+    {
+        for (size_t i = 0; i <= mask_; ++i)
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    ~ring()
+    {
+        while (drain([](T&) {}, mask_ + 1));
+    }
+
+    ring(ring const&) = delete;
+    ring& operator=(ring const&) = delete;
+
+    // false if the queue is full, the argument is left intact then
+    bool try_push(T&& x)
+    {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        cell* c;
+
+        for (;;)
+        {
+            c = &cells_[pos & mask_];
+            auto const seq = c->seq.load(std::memory_order_acquire);
+            auto const diff = intptr_t(seq) - intptr_t(pos);
+
+            if (diff == 0)
+            {
+                if (single_producer_)
+                {
+                    tail_.store(pos + 1, std::memory_order_relaxed);
+                    break;
+                }
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+                return false;
+            else
+                pos = tail_.load(std::memory_order_relaxed);
+        }
+
+        ::new (static_cast<void*>(c->storage)) T(std::move(x));
+        c->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer only, invokes f on at most max elements in FIFO order, returns the number processed
+    template <class F>
+    size_t drain(F&& f, size_t const max)
+    {
+        size_t n = 0;
+        size_t pos = head_.load(std::memory_order_relaxed);
+
+        for (; n < max; ++n, ++pos)
+        {
+            cell& c = cells_[pos & mask_];
+            if (c.seq.load(std::memory_order_acquire) != pos + 1)
+                break;
+
+            T* const x = std::launder(reinterpret_cast<T*>(c.storage));
+            head_.store(pos + 1, std::memory_order_relaxed);
+            try
+            {
+                f(*x);
+            }
+            catch (...)
+            {
+                release(c, x, pos);
+                throw;
+            }
+            release(c, x, pos);
+        }
+
+        return n;
+    }
+
+    bool empty() const noexcept
+    {
+        size_t const pos = head_.load(std::memory_order_relaxed);
+        return cells_[pos & mask_].seq.load(std::memory_order_acquire) != pos + 1;
+    }
+
+    size_t capacity() const noexcept { return mask_ + 1; }
+
+private:
+    struct cell
+    {
+        std::atomic<size_t> seq;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    void release(cell& c, T* x, size_t pos) noexcept
+    {
+        x->~T();
+        c.seq.store(pos + mask_ + 1, std::memory_order_release);
+    }
+
+    size_t const mask_;
+    bool const single_producer_;
+    std::unique_ptr<cell[]> const cells_;
+
+    alignas(cache_line_size) std::atomic<size_t> tail_ {0}; // producers
+    alignas(cache_line_size) std::atomic<size_t> head_ {0}; // consumer
+};
+
+/**
+ * Lifecycle participant inbox - a ring of messages plus the drain scheduling flag.
+ *
+ * The flag stays raised from the moment a drain is requested until the drain is over,
+ * so there is at most one drain in flight and the ring has a single consumer even when
+ * the execution context is multi-threaded.
+ */
+struct inbox
+{
+    using message_t = task;
+
+    static constexpr size_t batch_size = 64;
+
+    inbox(size_t capacity, bool single_producer): messages_ {capacity, single_producer} {}
+
+    bool try_push(message_t&& msg) { return messages_.try_push(std::move(msg)); }
+
+    // true if the caller has to schedule a drain
+    bool schedule() noexcept { return !scheduled_.exchange(true, std::memory_order_seq_cst); }
+
+    // runs up to batch_size messages, true if the caller has to schedule another drain
+    bool drain()
+    {
+        messages_.drain([](message_t& msg) { msg(); }, batch_size);
+
+        scheduled_.store(false, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return !messages_.empty() && schedule();
+    }
+
+    size_t capacity() const noexcept { return messages_.capacity(); }
+
+private:
+    ring<message_t> messages_;
+    alignas(cache_line_size) std::atomic<bool> scheduled_ {false};
+};
+
+} // namespace ufw
@@ -15,16 +15,46 @@
 #include <functional>
 #include <stdexcept>
 #include <type_traits>
+#include <utility>
 
 #include <dlfcn.h>
 
 namespace ufw {
 
+struct library;
+
+template <class F> struct symbol;
+
+/*
+ * Typed function from a library - a raw function pointer called at the native cost and the library
+ * reference held aside, keeping the library loaded while the symbol is alive
+ */
+template <class R, class... Args>
+struct symbol<R(Args...)> {
+    using pointer = R(*)(Args...);
+
+    symbol() noexcept = default;
+    symbol(pointer fp, std::shared_ptr<library const> library) noexcept: fp_ {fp}, library_ {std::move(library)} {}
+
+    // forwards, so that the arguments are copied at most once - into the call
+    template <class... A>
+    R operator()(A&&... args) const { return fp_(std::forward<A>(args)...); }
+
+    pointer get() const noexcept { return fp_; }
+    explicit operator bool() const noexcept { return fp_ != nullptr; }
+
+private:
+    pointer fp_ {};
+    std::shared_ptr<library const> library_;
+};
+
 /* 
  * Dynamic Library Abstraction
  */
 struct library final: std::enable_shared_from_this<library> {
-    static std::shared_ptr<library> load(char const* path);
+    // with `bind_now` all the undefined symbols are resolved in dlopen() (RTLD_NOW) rather than
+    // on the first call through each, which moves the lazy binding cost out of the hot path
+    static std::shared_ptr<library> load(char const* path, bool bind_now = false);
 
     ~library() noexcept
     {
@@ -32,7 +62,7 @@ struct library final: std::enable_shared_from_this<library> {
     }
 
     template <class F>
-    std::function<F> function(std::string const& name) const
+    ufw::symbol<F> symbol(std::string const& name) const
     {
         if (!handle_) throw std::runtime_error("library not open");
         dlerror();
@@ -40,36 +70,42 @@ struct library final: std::enable_shared_from_this<library> {
         const char *dlsym_error = dlerror();
         if (dlsym_error) throw std::runtime_error(dlsym_error);
 
-        // aliased shared_ptr to hold the library alive until all references
-        // to functions loaded from it are disposed
-        return func_helper<F>::create(std::shared_ptr<F>(shared_from_this(), fp));
+        return {fp, shared_from_this()};
+    }
+
+    // type-erased, prefer symbol() on the hot paths
+    template <class F>
+    std::function<F> function(std::string const& name) const
+    {
+        return symbol<F>(name);
+    }
+
+    bool exports(std::string const& name) const noexcept
+    {
+        return handle_ && dlsym(handle_, name.c_str());
     }
 
-    // ctors are not to be called directly, static method create() should be
+    // loaded with a null path, the executable itself and the plugins linked into it
+    bool executable() const noexcept { return executable_; }
+
+    // ctors are not to be called directly, static method load() should be
     // used instead
-    library(char const* path):
-        handle_(dlopen(path, RTLD_LAZY))
+    library(char const* path, bool bind_now = false):
+        handle_(dlopen(path, bind_now ? RTLD_NOW : RTLD_LAZY)),
+        executable_ {path == nullptr}
     {
         if (!handle_) throw std::runtime_error(dlerror());
     }
 
 private:
-    template <class F> struct func_helper;
-    template <class R, class... Args> struct func_helper <R(Args...)>
-    {
-        static std::function<R(Args...)> create(std::shared_ptr<R(Args...)> ptr)
-        {
-            return [=](Args&&... args) { return (**ptr)(std::forward<Args>(args)...); };
-        }
-    };
-
     void* handle_ = nullptr;
+    bool const executable_;
 };
 using library_ptr = std::shared_ptr<library>;
 
-inline library_ptr library::load(char const* path)
+inline library_ptr library::load(char const* path, bool bind_now)
 {
-    return std::make_shared<library>(path);
+    return std::make_shared<library>(path, bind_now);
 }
 
 struct library_entity: entity {
@@ -78,12 +114,28 @@ struct library_entity: entity {
             entity {std::forward<Args>(args)...},
             library_ {std::move(library)} {}
 
+    template <class F>
+    ufw::symbol<F> symbol(std::string const& name) const
+    {
+        return library_->template symbol<F>(name);
+    }
+
     template <class F>
     std::function<F> function(std::string const& name) const
     {
         return library_->template function<F>(name);
     }
 
+    bool exports(std::string const& name) const noexcept
+    {
+        return library_->exports(name);
+    }
+
+    bool executable() const noexcept
+    {
+        return library_->executable();
+    }
+
 private:
     library_ptr const library_;
 };
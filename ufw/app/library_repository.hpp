@@ -8,24 +8,91 @@
 
 #pragma once
 
+#include "application.hpp"
 #include "library.hpp"
 #include "loader.hpp"
 #include "configuration.hpp"
+#include "static_plugins.hpp"
 
+#include <boost/asio/post.hpp>
+
+#include <future>
 #include <memory>
 #include <string>
 #include <map>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 namespace ufw {
 
 struct library_repository final: loader {
     using loader::loader;
 
+    // the dlopen runs on the pool, after a read ahead request for the file, and load() waits for it
+    void prefetch(entity_id const& id, config_t const& cfg, boost::asio::thread_pool& pool) override
+    {
+        // config errors are reported by load() in the declaration order
+        if (!cfg["filename"])
+            return;
+
+        auto const filename = cfg["filename"].as<std::string>();
+        auto const bind_now = cfg["bind_now"] && cfg["bind_now"].as<bool>();
+        if (static_plugins::linked(static_plugins::library_stem(filename)))
+            return;
+
+        will_need(filename);
+
+        auto task = std::make_shared<std::packaged_task<library_ptr()>>([this, id, filename, bind_now]
+        {
+            startup_profile::scope const profiled {app().startup(), id, "prefetch"};
+            return library::load(filename.c_str(), bind_now);
+        });
+        prefetched_[id] = task->get_future();
+        boost::asio::post(pool, [task] { (*task)(); });
+    }
+
     std::unique_ptr<entity> load(entity_id const& id, resolved_entity_id rid, config_t const& cfg) override
     {
         auto const filename = cfg["filename"].as<std::string>();
-        return std::make_unique<library_entity>(library::load(filename.c_str()), id, rid, app());
+        auto const bind_now = cfg["bind_now"] && cfg["bind_now"].as<bool>();
+
+        // the plugins from it are linked into the executable, which stands for the library then
+        if (static_plugins::linked(static_plugins::library_stem(filename)))
+            return std::make_unique<library_entity>(library::load(nullptr), id, rid, app());
+
+        auto lib = [&]
+        {
+            startup_profile::scope const profiled {app().startup(), id, "dlopen"};
+            if (auto const it = prefetched_.find(id); it != prefetched_.end())
+            {
+                // rethrows the dlopen error
+                auto prefetched = std::move(it->second);
+                prefetched_.erase(it);
+                return prefetched.get();
+            }
+            return library::load(filename.c_str(), bind_now);
+        }();
+        return std::make_unique<library_entity>(std::move(lib), id, rid, app());
+    }
+
+private:
+    // starts filling the page cache, a file name without a slash is looked up by dlopen() in the library path
+    static void will_need([[maybe_unused]] std::string const& filename) noexcept
+    {
+#ifdef POSIX_FADV_WILLNEED
+        if (filename.find('/') == std::string::npos)
+            return;
+
+        if (int const fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC); fd >= 0)
+        {
+            ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+            ::close(fd);
+        }
+#endif
     }
+
+    std::map<entity_id, std::future<library_ptr>> prefetched_;
 };
 
 } // namespace ufw
@@ -6,10 +6,16 @@
 #pragma once
 
 #include "logger.hpp"
+#include "inbox.hpp"
+
+#include <memory>
 
 namespace ufw {
 
 struct entity;
+struct application;
+struct execution_context;
+struct handler_stats;
 
 struct lifecycle_participant
 {
@@ -25,7 +31,8 @@ struct lifecycle_participant
         auto* entity_ptr = dynamic_cast<entity const*>(this);
         if (entity_ptr)
         {
-            auto const get_logger = [&]()->logger_t& { return entity_ptr->get_logger(); };
+            [[maybe_unused]] auto const get_logger = [&]()->logger_t& { return entity_ptr->get_logger(); };
+            [[maybe_unused]] auto const get_log_source = [&]()->log_source const& { return entity_ptr->get_log_source(); };
             LOG_INF << "UP";
         }
     }
@@ -37,6 +44,17 @@ struct lifecycle_participant
     virtual void fini() noexcept {}
 
     virtual ~lifecycle_participant() = default;
+
+    // messages to the participant go through application::post(), the inbox is set up when the application structure is locked
+    ufw::inbox& inbox() const noexcept { return *inbox_; }
+
+private:
+    friend struct application;
+    std::unique_ptr<ufw::inbox> inbox_;
+    execution_context* context_ {}; // inbox drains run here
+    std::shared_ptr<handler_stats> stats_; // the messages are timed if set
+    char const* name_ {}; // the entity ID, for the traces
+
 };
 
 } // namespace ufw
@@ -8,6 +8,8 @@
 #include "entity.hpp"
 #include "configuration.hpp"
 
+#include <boost/asio/thread_pool.hpp>
+
 #include <functional>
 #include <memory>
 
@@ -17,6 +19,11 @@ struct loader: entity
 {
     using entity::entity;
     virtual std::unique_ptr<entity> load(entity_id const& id, resolved_entity_id rid, config_t const& cfg) = 0;
+
+    // called with each config of the loader before the first entity is loaded, when the bootstrap runs
+    // on a pool (see application_config::bootstrap_threads), to start the slow part of load() there,
+    // the entities are still loaded in the declaration order
+    virtual void prefetch(entity_id const& /*id*/, config_t const& /*cfg*/, boost::asio::thread_pool& /*pool*/) {}
 };
 
 using loader_func_t = std::function<std::unique_ptr<entity>(config_t const& cfg, entity_id const& id, resolved_entity_id rid, application& app)>;
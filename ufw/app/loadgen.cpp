@@ -0,0 +1,313 @@
+/*
+ * Synthetic load for soak and throughput runs of the launcher, two plugins:
+ *
+ *   loadgen_ctor  - publishes load_message to `subjects` subjects of a dispatcher round robin,
+ *                   at `rate` messages per second (0 - as fast as it can), `burst` messages back
+ *                   to back per slot, optionally in `on_ms`/`off_ms` phases, with the payload size
+ *                   drawn from [payload_min, payload_max]
+ *   loadsink_ctor - subscribes to the same subjects, checks the per source and subject sequence,
+ *                   counts the lost and reordered messages and the inbox overflows, records the
+ *                   publish to processing latency
+ *
+ * See examples/loadgen.yaml for the parameters.
+ */
+
+#include "entity.hpp"
+#include "lifecycle_participant.hpp"
+#include "application.hpp"
+#include "clock.hpp"
+#include "plugin_repository.hpp"
+#include "static_plugins.hpp"
+
+#include <ufw/topics/dispatcher.hpp>
+
+#include <boost/asio/steady_timer.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct load_message
+{
+    ufw::resolved_entity_id source;
+    uint32_t subject;
+    uint64_t seq; // per source and subject, from 0
+    int64_t sent_ns;
+    std::string_view payload; // valid for the duration of the publish
+};
+
+} // local namespace
+
+UFW_TOPIC_PAYLOAD(load_message, "ufw.load_message"); // the same topic IDs from any compiler
+
+namespace {
+
+std::vector<ufw::topic_id_t> load_topics(ufw::config_t const& params)
+{
+    auto const prefix = params["subject_prefix"].as<std::string>("load");
+    auto const subjects = params["subjects"].as<uint32_t>(1);
+    if (!subjects)
+        throw ufw::fatal_error("at least one subject expected");
+
+    std::vector<ufw::topic_id_t> topics;
+    for (uint32_t i = 0; i < subjects; ++i)
+        topics.push_back(ufw::topic_id_for<load_message>(prefix + "." + std::to_string(i)));
+    return topics;
+}
+
+ufw::dispatcher& load_dispatcher(ufw::config_t const& params, ufw::application& app)
+{
+    ufw::entity_ref<ufw::dispatcher> topics {params["topics_ref"].as<std::string>("TOPICS"), app};
+    topics.resolve();
+    return *topics.get();
+}
+
+struct load_generator: ufw::entity, ufw::lifecycle_participant
+{
+    load_generator(ufw::config_t const& params, ufw::entity_id const& id, ufw::resolved_entity_id rid, ufw::application& app):
+        entity {id, rid, app},
+        topics_ {load_dispatcher(params, app)},
+        topic_ids_ {load_topics(params)},
+        seq_(topic_ids_.size()),
+        rate_ {params["rate"].as<uint64_t>(0)},
+        burst_ {std::max(params["burst"].as<uint64_t>(1), uint64_t {1})},
+        on_ns_ {params["on_ms"].as<int64_t>(0) * 1'000'000},
+        off_ns_ {params["off_ms"].as<int64_t>(0) * 1'000'000},
+        duration_ns_ {int64_t(params["seconds"].as<double>(0) * 1e9)},
+        size_ {params["payload_min"].as<size_t>(0), std::max(params["payload_min"].as<size_t>(0), params["payload_max"].as<size_t>(0))},
+        random_ {rid},
+        timer_ {context().get_executor()},
+        sent_counter_ {make_counter("sent")},
+        bytes_counter_ {make_counter("sent_bytes")}
+    {
+        payload_.assign(size_.max(), 'x');
+    }
+
+    void start() override /* from lifecycle_participant */
+    {
+        running_ = true;
+        app().post(*this, [this]
+        {
+            start_ns_ = ufw::tsc_clock::monotonic_ns();
+            next_ns_ = start_ns_;
+            send_when_due();
+        });
+    }
+
+    void stop() noexcept override /* from lifecycle_participant */
+    {
+        running_ = false;
+    }
+
+    void fini() noexcept override /* from lifecycle_participant */
+    {
+        LOG_INF << "sent " << sent_.load(std::memory_order_relaxed) << " messages";
+    }
+
+private:
+    // a burst per slot, the slots `burst / rate` apart, so the average rate does not depend on the burst
+    void send_when_due()
+    {
+        if (!running_)
+            return;
+
+        auto const now = ufw::tsc_clock::monotonic_ns();
+        if (duration_ns_ && now - start_ns_ >= duration_ns_)
+        {
+            LOG_INF << "done, shutting down";
+            running_ = false;
+            boost::asio::post(app().context(), [this] { app().shutdown(); });
+            return;
+        }
+
+        if (!rate_)
+        {
+            // flat out, through the context queue now and then so that the other handlers on it keep running
+            for (int i = 0; i < 256; ++i)
+                send_burst(now);
+            context().post([this] { send_when_due(); });
+            return;
+        }
+
+        if (on_ns_ && off_ns_)
+        {
+            // the off phase is skipped, not caught up with later
+            if (auto const phase = (next_ns_ - start_ns_) % (on_ns_ + off_ns_); phase >= on_ns_)
+                next_ns_ += on_ns_ + off_ns_ - phase;
+        }
+
+        auto const wait_ns = next_ns_ - now;
+        if (wait_ns > 1'000'000)
+        {
+            timer_.expires_after(std::chrono::nanoseconds(wait_ns));
+            timer_.async_wait(ufw::recycling([this](boost::system::error_code const& ec)
+            {
+                if (!ec)
+                    send_when_due();
+            }));
+            return;
+        }
+        if (wait_ns > 0)
+        {
+            context().post([this] { send_when_due(); });
+            return;
+        }
+
+        send_burst(now);
+        next_ns_ += int64_t(burst_ * 1'000'000'000 / rate_);
+        context().post([this] { send_when_due(); });
+    }
+
+    void send_burst(int64_t const now)
+    {
+        uint64_t bytes = 0;
+        for (uint64_t i = 0; i < burst_; ++i)
+        {
+            auto const subject = uint32_t(next_subject_++ % topic_ids_.size());
+            auto const size = size_(random_);
+            topics_.publish(topic_ids_[subject], load_message {resolved_id(), subject, seq_[subject]++, now, {payload_.data(), size}});
+            bytes += size;
+        }
+        sent_.store(sent_.load(std::memory_order_relaxed) + burst_, std::memory_order_relaxed);
+        sent_counter_.add(burst_);
+        bytes_counter_.add(bytes);
+    }
+
+    ufw::dispatcher& topics_;
+    std::vector<ufw::topic_id_t> const topic_ids_;
+    std::vector<uint64_t> seq_;
+    uint64_t const rate_;
+    uint64_t const burst_;
+    int64_t const on_ns_;
+    int64_t const off_ns_;
+    int64_t const duration_ns_;
+    std::string payload_;
+    std::uniform_int_distribution<size_t> size_;
+    std::minstd_rand random_;
+    boost::asio::steady_timer timer_;
+    ufw::counter const sent_counter_;
+    ufw::counter const bytes_counter_;
+
+    std::atomic<bool> running_ {false};
+    std::atomic<uint64_t> sent_ {0};
+    int64_t start_ns_ {0};
+    int64_t next_ns_ {0};
+    uint64_t next_subject_ {0};
+};
+
+struct load_sink: ufw::entity, ufw::lifecycle_participant
+{
+    load_sink(ufw::config_t const& params, ufw::entity_id const& id, ufw::resolved_entity_id rid, ufw::application& app):
+        entity {id, rid, app},
+        hop_ {params["hop"].as<bool>(true)},
+        received_counter_ {make_counter("received")},
+        bytes_counter_ {make_counter("received_bytes")},
+        lost_counter_ {make_counter("lost")},
+        reordered_counter_ {make_counter("reordered")},
+        overflow_counter_ {make_counter("overflows")},
+        latency_ {make_histogram("latency_ns")}
+    {
+        auto& topics = load_dispatcher(params, app);
+        for (auto const topic_id: load_topics(params))
+        {
+            topics.subscribe<load_message>(topic_id, [this](load_message const& m)
+            {
+                if (!hop_)
+                {
+                    receive(m);
+                    return;
+                }
+
+                // the publisher's payload does not outlive the publish
+                try
+                {
+                    this->app().post(*this, [this, m, payload = std::string {m.payload}]
+                    {
+                        auto copy = m;
+                        copy.payload = payload;
+                        receive(copy);
+                    });
+                }
+                catch (ufw::transient_error const&)
+                {
+                    overflow_counter_.add();
+                    overflows_.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+    }
+
+    void fini() noexcept override /* from lifecycle_participant */
+    {
+        std::lock_guard<std::mutex> lock {mutex_};
+        LOG_INF << "received " << received_ << ", lost " << lost_ << ", reordered " << reordered_
+                << ", inbox overflows " << overflows_.load(std::memory_order_relaxed);
+    }
+
+private:
+    // from the sink inbox if hopping, from the publishers otherwise
+    void receive(load_message const& m)
+    {
+        latency_.record(uint64_t(std::max<int64_t>(ufw::tsc_clock::monotonic_ns() - m.sent_ns, 0)));
+        received_counter_.add();
+        bytes_counter_.add(m.payload.size());
+
+        auto const seq = m.seq;
+        std::lock_guard<std::mutex> lock {mutex_};
+        ++received_;
+        auto& expected = expected_[uint64_t {m.source} << 32 | m.subject];
+        if (seq == expected)
+        {
+            ++expected;
+        }
+        else if (seq > expected)
+        {
+            // the gap is counted as lost, a late arrival from it as reordered too
+            lost_ += seq - expected;
+            lost_counter_.add(seq - expected);
+            expected = seq + 1;
+        }
+        else
+        {
+            ++reordered_;
+            reordered_counter_.add();
+        }
+    }
+
+    bool const hop_;
+    ufw::counter const received_counter_;
+    ufw::counter const bytes_counter_;
+    ufw::counter const lost_counter_;
+    ufw::counter const reordered_counter_;
+    ufw::counter const overflow_counter_;
+    ufw::histogram const latency_;
+
+    std::mutex mutex_;
+    std::unordered_map<uint64_t, uint64_t> expected_; // the next sequence by the source and the subject
+    uint64_t received_ {0};
+    uint64_t lost_ {0};
+    uint64_t reordered_ {0};
+    std::atomic<uint64_t> overflows_ {0};
+};
+
+} // local namespace
+
+extern "C" ufw::entity* loadgen_ctor(ufw::entity_id const& id, ufw::resolved_entity_id rid, ufw::application& app, ufw::config_t const& params) {
+    return new load_generator {params, id, rid, app};
+}
+
+extern "C" ufw::entity* loadsink_ctor(ufw::entity_id const& id, ufw::resolved_entity_id rid, ufw::application& app, ufw::config_t const& params) {
+    return new load_sink {params, id, rid, app};
+}
+
+UFW_PLUGIN_PARAMS(loadgen_ctor);
+UFW_PLUGIN_PARAMS(loadsink_ctor);
+
+UFW_STATIC_PLUGIN(loadgen, loadgen_ctor);
+UFW_STATIC_PLUGIN(loadgen, loadsink_ctor);
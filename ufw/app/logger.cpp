@@ -7,8 +7,11 @@
 #include <boost/log/utility/setup/formatter_parser.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
+#include <algorithm>
+#include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include <pthread.h>
 
@@ -53,6 +56,97 @@ void configure_logger(std::string const& cfg)
     boost::log::init_from_stream(buf);
 }
 
+namespace {
+
+// the limited call sites that suppressed since started, the ones of unloaded plugins unlink in the destructor,
+// never destroyed as the static sites can be destroyed after it
+struct suppression_list
+{
+    std::mutex mutex;
+    std::vector<log_suppression*> sites;
+};
+
+suppression_list& suppressions()
+{
+    static auto* const instance = new suppression_list;
+    return *instance;
+}
+
+void write_suppressed(log_suppression const& site, uint64_t const suppressed)
+{
+#ifdef UFW_BINARY_LOGGER
+    binary_log::record_writer {get_log_source(), site.site_} << "[" << suppressed << " suppressed]";
+#else
+    BOOST_LOG_STREAM_WITH_PARAMS(
+       (get_logger()),
+          (set_get_attrib("File", site.file_))
+          (set_get_attrib("Line", site.site_.line))
+          (set_get_attrib("Func", site.func_))
+          (set_get_attrib("Tag", logging::string_literal("")))
+          (logging::keywords::severity = site.site_.severity)
+    ) << "[" << suppressed << " suppressed]";
+#endif
+}
+
+} // local namespace
+
+log_suppression::~log_suppression()
+{
+    if (state_.load(std::memory_order_relaxed) != linked)
+        return;
+
+    auto& list = suppressions();
+    std::lock_guard<std::mutex> lock {list.mutex};
+    list.sites.erase(std::remove(list.sites.begin(), list.sites.end(), this), list.sites.end());
+}
+
+void log_suppression::link() noexcept
+{
+    auto& list = suppressions();
+    std::lock_guard<std::mutex> lock {list.mutex};
+    if (state_.load(std::memory_order_relaxed) != unlinked)
+        return;
+    try
+    {
+        list.sites.push_back(this);
+        state_.store(linked, std::memory_order_relaxed);
+    }
+    catch (...)
+    {
+        // the count still goes with the next record written
+    }
+}
+
+size_t flush_suppressed_logs() noexcept
+{
+    auto& list = suppressions();
+    std::lock_guard<std::mutex> lock {list.mutex};
+
+    size_t flushed = 0;
+    for (auto const site: list.sites)
+    {
+        // retired first, the count stops growing then
+        if (site->flush_once_)
+            site->state_.store(log_suppression::retired, std::memory_order_relaxed);
+
+        if (auto const suppressed = site->take_suppressed())
+        {
+            try
+            {
+                write_suppressed(*site, suppressed);
+                ++flushed;
+            }
+            catch (...)
+            {
+                // a failing sink does not stop the others
+            }
+        }
+    }
+
+    list.sites.erase(std::remove_if(list.sites.begin(), list.sites.end(), [](auto const site) { return site->flush_once_; }), list.sites.end());
+    return flushed;
+}
+
 uint64_t get_tid() noexcept
 {
   uint64_t tid{};
@@ -16,6 +16,9 @@
 
 #pragma once
 
+#include "binary_logger.hpp"
+#include "clock.hpp"
+
 #include <boost/log/core.hpp>
 #include <boost/log/trivial.hpp>
 #include <boost/log/attributes.hpp>
@@ -23,6 +26,10 @@
 #include <boost/log/sources/severity_logger.hpp>
 #include <boost/thread/thread.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
 namespace logging  = boost::log;
 namespace attrs    = boost::log::attributes;
 
@@ -37,20 +44,36 @@ namespace ufw {
 
 using logger_t = boost::log::sources::severity_logger<logging::trivial::severity_level>;
 
-#define SET_LOG_LEVEL(LVL) do {\
-    logging::core::get()->set_filter(logging::trivial::severity >= logging::trivial::LVL); } while (0)
+// the statements below it are compiled out, one of trace, debug, info, warning, error, fatal
+#ifndef UFW_MIN_LOG_LEVEL
+#define UFW_MIN_LOG_LEVEL trace
+#endif
 
-#define LOG_SEV(sev) \
-   BOOST_LOG_STREAM_WITH_PARAMS( \
-      (get_logger()), \
-         (set_get_attrib("File", logging::string_literal(__FILE__))) \
-         (set_get_attrib("Line", __LINE__)) \
-         (set_get_attrib("Func", logging::string_literal(__func__))) \
-         (set_get_attrib("Tag", logging::string_literal(""))) \
-         (logging::keywords::severity = (logging::trivial::sev)) \
-   ) << ""
+// the global runtime level, the entities with a log_level in the config use theirs instead
+#define SET_LOG_LEVEL(LVL) \
+    ufw::log_threshold.store(int(logging::trivial::LVL), std::memory_order_relaxed)
 
-#define LOG_SEV_TAGGED(sev, tag) \
+#define LOG_COMPILED_OUT(sev) (logging::trivial::sev < logging::trivial::UFW_MIN_LOG_LEVEL)
+
+#ifdef UFW_BINARY_LOGGER
+
+// a static descriptor per call site, the arguments are copied raw to the thread ring and formatted on the backend thread
+#define LOG_SEV_GUARD(sev, tag) \
+   if constexpr (LOG_COMPILED_OUT(sev)) ; else \
+   if (static constexpr ufw::binary_log::site ufw_log_site_ {__FILE__, __LINE__, __func__, tag, logging::trivial::sev}; \
+         !ufw::log_enabled(get_log_source(), ufw_log_site_.severity)) ; else
+
+#define LOG_SEV_STREAM(sev, tag) \
+   ufw::binary_log::record_writer {get_log_source(), ufw_log_site_}
+
+#else
+
+// the level is checked first, the attributes are only set for the records that go through
+#define LOG_SEV_GUARD(sev, tag) \
+   if constexpr (LOG_COMPILED_OUT(sev)) ; else \
+   if (!ufw::log_enabled(get_log_source(), logging::trivial::sev)) ; else
+
+#define LOG_SEV_STREAM(sev, tag) \
    BOOST_LOG_STREAM_WITH_PARAMS( \
       (get_logger()), \
          (set_get_attrib("File", logging::string_literal(__FILE__))) \
@@ -60,11 +83,158 @@ using logger_t = boost::log::sources::severity_logger<logging::trivial::severity
          (logging::keywords::severity = (logging::trivial::sev)) \
    ) << ""
 
+#endif
+
+#define LOG_SEV_TAGGED(sev, tag) LOG_SEV_GUARD(sev, tag) LOG_SEV_STREAM(sev, tag)
+#define LOG_SEV(sev) LOG_SEV_TAGGED(sev, "")
+
 #define LOG_DBG LOG_SEV(debug)
 #define LOG_INF LOG_SEV(info)
 #define LOG_WRN LOG_SEV(warning)
 #define LOG_ERR LOG_SEV(error)
 
+/**
+ * The call site of a limited record, with the count of its records suppressed since the last one
+ * written. A site links itself to the process-wide list the first time it suppresses, and
+ * flush_suppressed_logs() writes the pending counts as records of their own, so that the count of
+ * a burst shows once it ends and not with the next record written, that may never come. A site
+ * flushed once is retired by the first flush and counts no more.
+ */
+struct log_suppression
+{
+    template <size_t F, size_t N>
+    constexpr log_suppression(char const (&file)[F], int const line, char const (&func)[N], logging::trivial::severity_level const severity, bool const flush_once) noexcept:
+        file_ {file}, func_ {func}, site_ {file, line, func, "", severity}, flush_once_ {flush_once} {}
+
+    ~log_suppression();
+
+    log_suppression(log_suppression const&) = delete;
+    log_suppression& operator=(log_suppression const&) = delete;
+
+    void suppress() noexcept
+    {
+        auto const state = state_.load(std::memory_order_relaxed);
+        if (state == retired)
+            return;
+        if (suppressed_.fetch_add(1, std::memory_order_relaxed) == 0 && state == unlinked)
+            link();
+    }
+
+    uint64_t take_suppressed() noexcept { return suppressed_.exchange(0, std::memory_order_relaxed); }
+
+    logging::string_literal const file_;
+    logging::string_literal const func_;
+    binary_log::site const site_;
+    bool const flush_once_;
+
+private:
+    friend size_t flush_suppressed_logs() noexcept;
+
+    enum link_state: uint8_t { unlinked, linked, retired };
+
+    void link() noexcept;
+
+    std::atomic<uint64_t> suppressed_ {0};
+    std::atomic<link_state> state_ {unlinked};
+};
+
+// writes a "[N suppressed]" record for every limited call site with a pending count, returns the number of them
+size_t flush_suppressed_logs() noexcept;
+
+// every n-th record of the call site, starting with the first one, the ones skipped are implied by n (0 taken for 1)
+struct log_every_n
+{
+    template <size_t F, size_t N>
+    constexpr log_every_n(char const (&)[F], int, char const (&)[N], logging::trivial::severity_level, uint64_t n) noexcept:
+        n_ {std::max(n, uint64_t {1})} {}
+
+    log_admission admit() noexcept { return {count_.fetch_add(1, std::memory_order_relaxed) % n_ == 0}; }
+
+private:
+    uint64_t const n_;
+    std::atomic<uint64_t> count_ {0};
+};
+
+// the first n records of the call site, the count of the ones after them is flushed once
+struct log_first_n: log_suppression
+{
+    template <size_t F, size_t N>
+    constexpr log_first_n(char const (&file)[F], int const line, char const (&func)[N], logging::trivial::severity_level const severity, uint64_t n) noexcept:
+        log_suppression {file, line, func, severity, true}, n_ {n} {}
+
+    log_admission admit() noexcept
+    {
+        // the count stops at n, and the suppressed one once flushed, no more writes to the shared lines then
+        if (count_.load(std::memory_order_relaxed) < n_ && count_.fetch_add(1, std::memory_order_relaxed) < n_)
+            return {true};
+        suppress();
+        return {false};
+    }
+
+private:
+    uint64_t const n_;
+    std::atomic<uint64_t> count_ {0};
+};
+
+/**
+ * Token bucket of `burst` records refilled at `per_second` (0 taken for 1 for both), kept as the
+ * theoretical arrival time of the next record (GCRA) so that a single CAS admits one. The first
+ * record after a burst carries the count of the ones suppressed, unless flushed before.
+ */
+struct log_rate_limit: log_suppression
+{
+    template <size_t F, size_t N>
+    constexpr log_rate_limit(char const (&file)[F], int const line, char const (&func)[N], logging::trivial::severity_level const severity, uint64_t per_second, uint64_t burst) noexcept:
+        log_suppression {file, line, func, severity, false},
+        interval_ns_ {int64_t(1'000'000'000 / std::max(per_second, uint64_t {1}))},
+        tolerance_ns_ {interval_ns_ * int64_t(std::max(burst, uint64_t {1}) - 1)} {}
+
+    log_admission admit() noexcept
+    {
+        int64_t const now = tsc_clock::monotonic_ns();
+
+        int64_t tat = tat_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            int64_t const start = std::max(tat, now);
+            if (start - now > tolerance_ns_)
+            {
+                suppress();
+                return {false};
+            }
+            if (tat_.compare_exchange_weak(tat, start + interval_ns_, std::memory_order_relaxed))
+                return {true, take_suppressed()};
+        }
+    }
+
+private:
+    int64_t const interval_ns_;
+    int64_t const tolerance_ns_;
+    std::atomic<int64_t> tat_ {0};
+};
+
+// the limiter is a static per call site, touched only if the level is enabled
+#define LOG_SEV_LIMITED(sev, limiter, ...) \
+   LOG_SEV_GUARD(sev, "") \
+   if (static limiter ufw_log_limiter_ {__FILE__, __LINE__, __func__, logging::trivial::sev, __VA_ARGS__}; false) ; else \
+   if (ufw::log_admission const ufw_log_admission_ = ufw_log_limiter_.admit(); !ufw_log_admission_) ; else \
+      LOG_SEV_STREAM(sev, "") << ufw_log_admission_
+
+#define LOG_DBG_EVERY_N(n) LOG_SEV_LIMITED(debug, ufw::log_every_n, n)
+#define LOG_INF_EVERY_N(n) LOG_SEV_LIMITED(info, ufw::log_every_n, n)
+#define LOG_WRN_EVERY_N(n) LOG_SEV_LIMITED(warning, ufw::log_every_n, n)
+#define LOG_ERR_EVERY_N(n) LOG_SEV_LIMITED(error, ufw::log_every_n, n)
+
+#define LOG_DBG_FIRST_N(n) LOG_SEV_LIMITED(debug, ufw::log_first_n, n)
+#define LOG_INF_FIRST_N(n) LOG_SEV_LIMITED(info, ufw::log_first_n, n)
+#define LOG_WRN_FIRST_N(n) LOG_SEV_LIMITED(warning, ufw::log_first_n, n)
+#define LOG_ERR_FIRST_N(n) LOG_SEV_LIMITED(error, ufw::log_first_n, n)
+
+#define LOG_DBG_RATE_LIMITED(per_second, burst) LOG_SEV_LIMITED(debug, ufw::log_rate_limit, per_second, burst)
+#define LOG_INF_RATE_LIMITED(per_second, burst) LOG_SEV_LIMITED(info, ufw::log_rate_limit, per_second, burst)
+#define LOG_WRN_RATE_LIMITED(per_second, burst) LOG_SEV_LIMITED(warning, ufw::log_rate_limit, per_second, burst)
+#define LOG_ERR_RATE_LIMITED(per_second, burst) LOG_SEV_LIMITED(error, ufw::log_rate_limit, per_second, burst)
+
 uint64_t get_tid() noexcept;
 
 #define LOG_STAMP_THREAD\
@@ -77,3 +247,4 @@ void configure_logger(std::string const& cfg);
 } // namespace ufw
 
 inline decltype(auto) get_logger() { return logging::trivial::logger::get(); }
+inline ufw::log_source const& get_log_source() { static ufw::log_source const source {}; return source; }
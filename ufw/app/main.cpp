@@ -19,6 +19,9 @@
 #include "logger.hpp"
 #include "library_repository.hpp"
 #include "plugin_repository.hpp"
+#include "static_plugins.hpp"
+
+#include <ufw/topics/dispatcher.hpp>
 
 #include <boost/exception/diagnostic_information.hpp>
 
@@ -39,8 +42,14 @@ int main(int argc, char const** argv)
         ufw::application app;
         app.add<ufw::library_repository>("LIBRARY");
         app.add<ufw::plugin_repository>("PLUGIN");
-
-        app.load(argc, argv);
+        app.add<ufw::static_plugin_repository>("STATIC");
+        app.register_loader("TOPICS", [](ufw::config_t const&, ufw::entity_id const& id, ufw::resolved_entity_id rid, ufw::application& app)
+        {
+            return std::make_unique<ufw::dispatcher>(id, rid, app);
+        });
+
+        if (!app.load(argc, argv))
+            return 0;
 
         app.run();
     }
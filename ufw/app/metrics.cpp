@@ -0,0 +1,293 @@
+#include "metrics.hpp"
+
+#include "clock.hpp"
+#include "exception_types.hpp"
+
+#include <iomanip>
+#include <new>
+#include <unordered_map>
+
+namespace ufw {
+
+namespace {
+
+std::atomic<uint64_t> last_registry_id {0};
+
+// the registries alive, for the exiting threads to find theirs, leaked for the threads exiting late
+struct live_registries
+{
+    std::mutex mutex;
+    std::unordered_map<uint64_t, metrics_registry*> registries;
+};
+
+live_registries& live()
+{
+    static auto* const instance = new live_registries;
+    return *instance;
+}
+
+// keeps the escapes simple, the metric names are entity IDs and identifiers
+void write_json_string(std::ostream& out, std::string const& s)
+{
+    out << '"';
+    for (char const c: s)
+    {
+        if (c == '"' || c == '\\')
+            out << '\\';
+        out << c;
+    }
+    out << '"';
+}
+
+} // local namespace
+
+metrics_shard::~metrics_shard()
+{
+    for (auto& page: pages_)
+        delete[] page.load(std::memory_order_relaxed);
+}
+
+std::atomic<uint64_t>* metrics_shard::add_page(size_t const index)
+{
+    auto* page = new std::atomic<uint64_t>[page_size] {};
+    pages_[index].store(page, std::memory_order_release);
+    return page;
+}
+
+void metrics_shard::absorb(metrics_shard const& other)
+{
+    // the pages first, nothing is added if one fails
+    for (size_t i = 0; i < max_pages; ++i)
+        if (other.pages_[i].load(std::memory_order_acquire) && !pages_[i].load(std::memory_order_relaxed))
+            add_page(i);
+
+    for (size_t i = 0; i < max_pages; ++i)
+        if (auto const* page = other.pages_[i].load(std::memory_order_acquire))
+            for (size_t j = 0; j < page_size; ++j)
+                if (auto const n = page[j].load(std::memory_order_relaxed))
+                    add(uint32_t(i * page_size + j), n);
+}
+
+// the shards the thread writes to, retired when it exits
+struct metrics_registry::thread_shards
+{
+    ~thread_shards()
+    {
+        for (auto const& [registry_id, shard]: shards)
+            retire(registry_id, shard);
+    }
+
+    std::vector<std::pair<uint64_t, metrics_shard*>> shards;
+};
+
+metrics_registry::metrics_registry():
+    id_ {++last_registry_id}
+{
+    auto& x = live();
+    std::lock_guard<std::mutex> lock {x.mutex};
+    x.registries.emplace(id_, this);
+}
+
+metrics_registry::~metrics_registry()
+{
+    // the threads exiting from now on find nothing to retire their shards to
+    auto& x = live();
+    std::lock_guard<std::mutex> lock {x.mutex};
+    x.registries.erase(id_);
+}
+
+uint32_t metrics_registry::add(std::string const& name, kind const k, uint32_t const slots)
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+
+    if (auto it = descriptor_ids_.find(name); it != descriptor_ids_.end())
+    {
+        auto const& existing = descriptors_[it->second];
+        if (existing.k != k)
+            throw fatal_error("metric " + name + " already registered as another kind");
+        return existing.index;
+    }
+
+    uint32_t index;
+    if (k == kind::gauge)
+    {
+        index = uint32_t(gauges_.size());
+        gauges_.emplace_back(0);
+    }
+    else
+    {
+        if (slots > max_slots - slots_used_)
+            throw fatal_error("too many metrics, cannot add " + name);
+        index = slots_used_;
+        slots_used_ += slots;
+    }
+
+    descriptor_ids_.emplace(name, descriptors_.size());
+    descriptors_.push_back({name, k, index});
+    return index;
+}
+
+counter metrics_registry::counter(std::string const& name)
+{
+    return {this, add(name, kind::counter, 1)};
+}
+
+gauge metrics_registry::gauge(std::string const& name)
+{
+    auto const index = add(name, kind::gauge, 0);
+    std::lock_guard<std::mutex> lock {mutex_};
+    return ufw::gauge {&gauges_[index]};
+}
+
+histogram metrics_registry::histogram(std::string const& name)
+{
+    return {this, add(name, kind::histogram, ufw::histogram::bucket_count + 1)};
+}
+
+metrics_shard& metrics_registry::attach()
+{
+    // a thread going back and forth between registries gets its shard back, the registry IDs are
+    // never reused, so the entries of the destroyed ones are never matched
+    thread_local thread_shards attached;
+    for (auto const& [registry_id, shard]: attached.shards)
+        if (registry_id == id_)
+            return *shard;
+
+    {
+        // the entries of the registries destroyed since, their shards went with them
+        auto& x = live();
+        std::lock_guard<std::mutex> lock {x.mutex};
+        std::erase_if(attached.shards, [&x](auto const& entry) { return !x.registries.contains(entry.first); });
+    }
+    attached.shards.reserve(attached.shards.size() + 1);
+
+    auto shard = std::make_unique<metrics_shard>();
+    std::lock_guard<std::mutex> lock {mutex_};
+    shards_.push_back(std::move(shard));
+    attached.shards.emplace_back(id_, shards_.back().get());
+    return *shards_.back();
+}
+
+void metrics_registry::retire(uint64_t const registry_id, metrics_shard* const shard) noexcept
+{
+    auto& x = live();
+    std::lock_guard<std::mutex> live_lock {x.mutex}; // holds the registry destructor off
+    auto const it = x.registries.find(registry_id);
+    if (it == x.registries.end())
+        return;
+
+    auto& registry = *it->second;
+    std::lock_guard<std::mutex> lock {registry.mutex_};
+    try
+    {
+        registry.retired_.absorb(*shard);
+    }
+    catch (std::bad_alloc const&)
+    {
+        return; // the shard stays then, with its counts
+    }
+    std::erase_if(registry.shards_, [shard](auto const& x) { return x.get() == shard; });
+}
+
+size_t metrics_registry::shards() const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    return shards_.size();
+}
+
+metrics_snapshot metrics_registry::snapshot() const
+{
+    metrics_snapshot result {tsc_clock::wall_ns(), {}, {}, {}};
+
+    std::lock_guard<std::mutex> lock {mutex_};
+
+    auto const sum = [&](uint32_t const slot)
+    {
+        uint64_t n = retired_.read(slot);
+        for (auto const& shard: shards_)
+            n += shard->read(slot);
+        return n;
+    };
+
+    std::vector<uint64_t> buckets(ufw::histogram::bucket_count);
+
+    for (auto const& d: descriptors_)
+    {
+        switch (d.k)
+        {
+        case kind::counter:
+            result.counters.emplace_back(d.name, sum(d.index));
+            break;
+
+        case kind::gauge:
+            result.gauges.emplace_back(d.name, gauges_[d.index].load(std::memory_order_relaxed));
+            break;
+
+        case kind::histogram:
+        {
+            uint64_t count = 0;
+            for (uint32_t i = 0; i < buckets.size(); ++i)
+                count += buckets[i] = sum(d.index + i);
+
+            metrics_snapshot::histogram_summary summary {d.name, count, 0, 0, 0, 0, 0, 0};
+            if (count)
+            {
+                summary.mean = double(sum(d.index + ufw::histogram::bucket_count)) / double(count);
+
+                auto const percentile = [&](double const p)
+                {
+                    auto const rank = uint64_t(p * double(count - 1)) + 1;
+                    uint64_t seen = 0;
+                    for (uint32_t i = 0; i < buckets.size(); ++i)
+                        if ((seen += buckets[i]) >= rank)
+                            return ufw::histogram::upper_bound(i);
+                    return uint64_t {0};
+                };
+
+                summary.p50 = percentile(0.5);
+                summary.p90 = percentile(0.9);
+                summary.p99 = percentile(0.99);
+                summary.p999 = percentile(0.999);
+                summary.max = percentile(1);
+            }
+            result.histograms.push_back(std::move(summary));
+            break;
+        }
+        }
+    }
+
+    return result;
+}
+
+void metrics_snapshot::write_json(std::ostream& out) const
+{
+    out << "{\"timestamp_ns\":" << timestamp_ns << ",\"counters\":{";
+    for (size_t i = 0; i < counters.size(); ++i)
+    {
+        out << (i ? "," : "");
+        write_json_string(out, counters[i].first);
+        out << ':' << counters[i].second;
+    }
+
+    out << "},\"gauges\":{";
+    for (size_t i = 0; i < gauges.size(); ++i)
+    {
+        out << (i ? "," : "");
+        write_json_string(out, gauges[i].first);
+        out << ':' << gauges[i].second;
+    }
+
+    out << "},\"histograms\":{";
+    for (size_t i = 0; i < histograms.size(); ++i)
+    {
+        auto const& h = histograms[i];
+        out << (i ? "," : "");
+        write_json_string(out, h.name);
+        out << ":{\"count\":" << h.count << ",\"mean\":" << std::fixed << std::setprecision(1) << h.mean
+            << ",\"p50\":" << h.p50 << ",\"p90\":" << h.p90 << ",\"p99\":" << h.p99
+            << ",\"p999\":" << h.p999 << ",\"max\":" << h.max << '}';
+    }
+    out << "}}\n";
+}
+
+} // namespace ufw
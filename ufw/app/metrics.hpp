@@ -0,0 +1,238 @@
+/* Copyright (c) 2026 Vladimir Lysyy (mrbald@github)
+ * ALv2 (http://www.apache.org/licenses/LICENSE-2.0)
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ufw {
+
+/**
+ * Per-thread metric slots, written by the owner thread only (a relaxed load and store,
+ * no locked instructions), read by the aggregation. Allocated in pages on the first touch
+ * (std::bad_alloc then) so that a thread updating a couple of counters does not pay for
+ * all the histograms.
+ */
+struct metrics_shard
+{
+    static constexpr size_t page_size = 1024;
+    static constexpr size_t max_pages = 256;
+
+    metrics_shard() = default;
+    ~metrics_shard();
+
+    metrics_shard(metrics_shard const&) = delete;
+    metrics_shard& operator=(metrics_shard const&) = delete;
+
+    void add(uint32_t const slot, uint64_t const n)
+    {
+        auto& x = at(slot);
+        x.store(x.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    // any thread, 0 if never written
+    uint64_t read(uint32_t const slot) const noexcept
+    {
+        auto const* page = pages_[slot / page_size].load(std::memory_order_acquire);
+        return page ? page[slot % page_size].load(std::memory_order_relaxed) : 0;
+    }
+
+    // adds up the other shard slots, all or nothing, the caller serializes the writers
+    void absorb(metrics_shard const& other);
+
+private:
+    std::atomic<uint64_t>& at(uint32_t const slot)
+    {
+        auto* page = pages_[slot / page_size].load(std::memory_order_relaxed);
+        if (!page) [[unlikely]]
+            page = add_page(slot / page_size);
+        return page[slot % page_size];
+    }
+
+    std::atomic<uint64_t>* add_page(size_t index);
+
+    std::array<std::atomic<std::atomic<uint64_t>*>, max_pages> pages_ {};
+};
+
+struct metrics_registry;
+
+// monotonically increasing, summed over the threads on aggregation
+struct counter
+{
+    counter() = default;
+
+    void add(uint64_t n = 1) const;
+
+private:
+    friend struct metrics_registry;
+    counter(metrics_registry* registry, uint32_t slot) noexcept: registry_ {registry}, slot_ {slot} {}
+
+    metrics_registry* registry_ {};
+    uint32_t slot_ {};
+};
+
+// the last value set by any thread
+struct gauge
+{
+    gauge() = default;
+
+    void set(int64_t const value) const noexcept { value_->store(value, std::memory_order_relaxed); }
+    void add(int64_t const delta) const noexcept { value_->fetch_add(delta, std::memory_order_relaxed); }
+
+private:
+    friend struct metrics_registry;
+    explicit gauge(std::atomic<int64_t>* value) noexcept: value_ {value} {}
+
+    std::atomic<int64_t>* value_ {};
+};
+
+/**
+ * HDR-style log-linear histogram of non-negative integer values (nanoseconds, bytes, ...)
+ * - 16 linear sub-buckets per power of two, which bounds the relative error by 1/16,
+ * values above 2^40 land in the last bucket.
+ */
+struct histogram
+{
+    static constexpr unsigned sub_bucket_bits = 4;
+    static constexpr uint64_t sub_bucket_count = uint64_t {1} << sub_bucket_bits;
+    static constexpr unsigned max_value_bits = 40;
+    static constexpr uint32_t bucket_count = (max_value_bits - sub_bucket_bits + 1) * sub_bucket_count;
+
+    static constexpr uint32_t bucket(uint64_t const value) noexcept
+    {
+        if (value < sub_bucket_count)
+            return uint32_t(value);
+        if (value >> max_value_bits)
+            return bucket_count - 1;
+        unsigned const exponent = 63 - __builtin_clzll(value);
+        uint64_t const sub_bucket = (value >> (exponent - sub_bucket_bits)) & (sub_bucket_count - 1);
+        return uint32_t((exponent - sub_bucket_bits + 1) * sub_bucket_count + sub_bucket);
+    }
+
+    // the highest value landing in the bucket
+    static constexpr uint64_t upper_bound(uint32_t const bucket) noexcept
+    {
+        if (bucket < sub_bucket_count)
+            return bucket;
+        unsigned const exponent = bucket / sub_bucket_count + sub_bucket_bits - 1;
+        uint64_t const sub_bucket = bucket % sub_bucket_count;
+        return ((sub_bucket_count + sub_bucket + 1) << (exponent - sub_bucket_bits)) - 1;
+    }
+
+    histogram() = default;
+
+    void record(uint64_t value) const;
+
+private:
+    friend struct metrics_registry;
+    histogram(metrics_registry* registry, uint32_t slot) noexcept: registry_ {registry}, slot_ {slot} {}
+
+    metrics_registry* registry_ {};
+    uint32_t slot_ {}; // bucket_count buckets followed by the sum
+};
+
+struct metrics_snapshot
+{
+    struct histogram_summary
+    {
+        std::string name;
+        uint64_t count;
+        double mean;
+        uint64_t p50, p90, p99, p999, max; // bucket upper bounds
+    };
+
+    int64_t timestamp_ns; // since the epoch
+    std::vector<std::pair<std::string, uint64_t>> counters;
+    std::vector<std::pair<std::string, int64_t>> gauges;
+    std::vector<histogram_summary> histograms;
+
+    void write_json(std::ostream& out) const;
+};
+
+/**
+ * Named counters, gauges and histograms. Registering is idempotent - the same name gives
+ * the same metric, of the same kind or a fatal_error. Updates go to the calling thread
+ * shard, snapshot() sums the shards. The shard of an exiting thread is folded into the
+ * retired total and freed, so the counts stay and the thread churn does not add up.
+ */
+struct metrics_registry
+{
+    static constexpr uint32_t max_slots = metrics_shard::page_size * metrics_shard::max_pages;
+
+    metrics_registry();
+    ~metrics_registry();
+
+    metrics_registry(metrics_registry const&) = delete;
+    metrics_registry& operator=(metrics_registry const&) = delete;
+
+    ufw::counter counter(std::string const& name);
+    ufw::gauge gauge(std::string const& name);
+    ufw::histogram histogram(std::string const& name);
+
+    metrics_snapshot snapshot() const;
+
+    // the threads with a shard of their own, the exited ones are in the retired total
+    size_t shards() const;
+
+    metrics_shard& local_shard()
+    {
+        thread_local struct { uint64_t registry_id; metrics_shard* shard; } cache {};
+        if (cache.registry_id != id_) [[unlikely]]
+            cache = {id_, &attach()};
+        return *cache.shard;
+    }
+
+private:
+    enum class kind { counter, gauge, histogram };
+
+    struct descriptor
+    {
+        std::string name;
+        kind k;
+        uint32_t index; // the slot, or the gauge index
+    };
+
+    struct thread_shards;
+
+    // returns the index
+    uint32_t add(std::string const& name, kind k, uint32_t slots);
+    metrics_shard& attach();
+
+    // at the thread exit, a no-op if the registry is gone
+    static void retire(uint64_t registry_id, metrics_shard* shard) noexcept;
+
+    uint64_t const id_; // unique for the process lifetime, unlike the address
+
+    mutable std::mutex mutex_;
+    std::vector<descriptor> descriptors_;
+    std::map<std::string, size_t, std::less<>> descriptor_ids_;
+    uint32_t slots_used_ {0};
+    std::deque<std::atomic<int64_t>> gauges_;
+    std::vector<std::unique_ptr<metrics_shard>> shards_;
+    metrics_shard retired_; // the sums of the shards of the exited threads
+};
+
+inline void counter::add(uint64_t const n) const
+{
+    registry_->local_shard().add(slot_, n);
+}
+
+inline void histogram::record(uint64_t const value) const
+{
+    auto& shard = registry_->local_shard();
+    shard.add(slot_ + bucket(value), 1);
+    shard.add(slot_ + bucket_count, value);
+}
+
+} // namespace ufw
@@ -0,0 +1,63 @@
+#include "metrics_service.hpp"
+
+#include "application.hpp"
+
+#include <cstdio>
+#include <fstream>
+
+namespace ufw {
+
+metrics_service::metrics_service(config_t const& cfg, entity_id const& id, resolved_entity_id rid, application& app):
+    entity {id, rid, app},
+    path_ {cfg["path"] ? cfg["path"].as<std::string>() : std::string {"/dev/shm/ufw-metrics.json"}},
+    interval_ {cfg["interval_ms"] ? cfg["interval_ms"].as<int64_t>() : 1000},
+    timer_ {context().get_executor()}
+{
+}
+
+void metrics_service::start()
+{
+    LOG_INF << "dumping metrics to " << path_ << " every " << interval_.count() << " ms";
+    app().post(*this, [this] { schedule_dump(); });
+}
+
+void metrics_service::stop() noexcept
+{
+    timer_.cancel(); // the execution contexts are stopped by now
+    dump();
+}
+
+void metrics_service::schedule_dump()
+{
+    timer_.expires_after(interval_);
+    timer_.async_wait(recycling([this](boost::system::error_code const& ec)
+    {
+        if (ec)
+            return;
+        dump();
+        schedule_dump();
+    }));
+}
+
+void metrics_service::dump() noexcept
+{
+    // readers see either the previous snapshot or the new one, never a partial write
+    auto const tmp_path = path_ + ".tmp";
+    try
+    {
+        {
+            std::ofstream out {tmp_path, std::ios::trunc};
+            app().metrics().snapshot().write_json(out);
+            if (!out)
+                throw std::runtime_error("write failed");
+        }
+        if (std::rename(tmp_path.c_str(), path_.c_str()))
+            throw std::runtime_error("rename failed");
+    }
+    catch (std::exception const& ex)
+    {
+        LOG_ERR_RATE_LIMITED(1, 1) << "failed to dump metrics to " << path_ << ": " << ex.what();
+    }
+}
+
+} // namespace ufw
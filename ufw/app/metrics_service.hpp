@@ -0,0 +1,39 @@
+/* Copyright (c) 2026 Vladimir Lysyy (mrbald@github)
+ * ALv2 (http://www.apache.org/licenses/LICENSE-2.0)
+ */
+
+#pragma once
+
+#include "configuration.hpp"
+#include "entity.hpp"
+#include "lifecycle_participant.hpp"
+
+#include <boost/asio/steady_timer.hpp>
+
+#include <chrono>
+#include <string>
+
+namespace ufw {
+
+/**
+ * The METRICS entity, aggregates the application metrics every `interval_ms` (1000 by default)
+ * and replaces `path` with the JSON snapshot, a path under /dev/shm keeps it in shared memory
+ * for local tools to poll. The final snapshot is written at stop().
+ */
+struct metrics_service: entity, lifecycle_participant
+{
+    metrics_service(config_t const& cfg, entity_id const& id, resolved_entity_id rid, application& app);
+
+    void start() override;
+    void stop() noexcept override;
+
+private:
+    void schedule_dump();
+    void dump() noexcept;
+
+    std::string const path_;
+    std::chrono::milliseconds const interval_;
+    boost::asio::steady_timer timer_;
+};
+
+} // namespace ufw
@@ -7,9 +7,12 @@
 
 #pragma once
 
+#include "application.hpp"
+#include "exception_types.hpp"
 #include "library_repository.hpp"
 #include "library.hpp"
 #include "loader.hpp"
+#include "static_plugins.hpp"
 
 #include <memory>
 #include <string>
@@ -17,6 +20,12 @@
 
 namespace ufw {
 
+// the symbol UFW_PLUGIN_PARAMS exports for a constructor
+inline std::string plugin_params_tag(std::string const& constructor)
+{
+    return "ufw_plugin_params_" + constructor;
+}
+
 struct plugin_repository final: loader {
     using loader::loader;
 
@@ -28,8 +37,39 @@ struct plugin_repository final: loader {
         entity_ref<library_entity> lib {library_ref, app()};
         lib.resolve();
 
-        return std::unique_ptr<entity>{ lib->function<entity*(entity_id const&, resolved_entity_id, application&)>(constructor)(id, rid, app()) };
+        // the library_ref stands for the executable when LIBRARY found the plugins from it linked in,
+        // a constructor of the same name from a library loaded for real does not get shadowed
+        if (lib->executable() && static_plugins::contains(constructor))
+        {
+            LOG_INF << id << " is constructed with the linked in " << constructor;
+            return static_plugins::construct(id, rid, app(), cfg);
+        }
+        LOG_INF << id << " is constructed with " << constructor << " from " << library_ref;
+
+        // the signature is the one the plugin declares, not the one the config implies
+        auto const params = cfg["params"];
+        bool const takes_params = lib->exports(plugin_params_tag(constructor));
+        if (bool(params) != takes_params)
+            throw fatal_error("plugin constructor " + constructor + (takes_params ? " takes params" : " takes no params") + ", check configuration of " + id);
+
+        if (takes_params)
+        {
+            auto const ctor = lib->symbol<entity*(entity_id const&, resolved_entity_id, application&, config_t const&)>(constructor);
+
+            startup_profile::scope const profiled {app().startup(), id, "construct"};
+            return std::unique_ptr<entity>{ ctor(id, rid, app(), params) };
+        }
+
+        auto const ctor = lib->symbol<entity*(entity_id const&, resolved_entity_id, application&)>(constructor);
+
+        startup_profile::scope const profiled {app().startup(), id, "construct"};
+        return std::unique_ptr<entity>{ ctor(id, rid, app()) };
     }
 };
 
 } // namespace ufw
+
+// UFW_PLUGIN_PARAMS(constructor) at the namespace scope of a plugin with an extern "C" constructor taking
+// the `params` config as the fourth argument, PLUGIN calls the constructors without it with three
+#define UFW_PLUGIN_PARAMS(ctor) \
+    extern "C" [[maybe_unused]] char const ufw_plugin_params_##ctor = 1
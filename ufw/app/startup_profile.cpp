@@ -0,0 +1,69 @@
+#include "startup_profile.hpp"
+
+#include <iomanip>
+
+#include <time.h>
+
+namespace ufw {
+
+namespace {
+
+int64_t thread_cpu_ns() noexcept
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return int64_t(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+}
+
+} // local namespace
+
+startup_profile::scope::scope(startup_profile& profile, std::string entity, char const* const stage):
+    profile_ {profile},
+    entity_ {std::move(entity)},
+    stage_ {stage},
+    wall_begin_ {std::chrono::steady_clock::now()},
+    cpu_begin_ns_ {thread_cpu_ns()}
+{
+}
+
+startup_profile::scope::~scope()
+{
+    auto const wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - wall_begin_).count();
+    try
+    {
+        profile_.add({std::move(entity_), stage_, wall_ns, thread_cpu_ns() - cpu_begin_ns_});
+    }
+    catch (...)
+    {
+        // losing a sample is fine
+    }
+}
+
+void startup_profile::add(sample s)
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    if (!closed_)
+        samples_.push_back(std::move(s));
+}
+
+std::vector<startup_profile::sample> startup_profile::close()
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    closed_ = true;
+    return std::move(samples_);
+}
+
+void startup_profile::write_json(std::ostream& out, std::vector<sample> const& samples)
+{
+    // std::quoted escapes the quotes and backslashes the JSON way, the IDs have no control characters
+    out << "{\"samples\":[";
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        auto const& s = samples[i];
+        out << (i ? "," : "") << "\n{\"entity\":" << std::quoted(s.entity) << ",\"stage\":\"" << s.stage
+            << "\",\"wall_ns\":" << s.wall_ns << ",\"cpu_ns\":" << s.cpu_ns << '}';
+    }
+    out << "\n]}\n";
+}
+
+} // namespace ufw
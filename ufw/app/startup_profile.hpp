@@ -0,0 +1,64 @@
+/* Copyright (c) 2026 Vladimir Lysyy (mrbald@github)
+ * ALv2 (http://www.apache.org/licenses/LICENSE-2.0)
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ufw {
+
+/**
+ * Wall and CPU time of the startup stages per entity - the application config parsing, the
+ * loading (with the library dlopen and the plugin construction inside), init() and start().
+ * The CPU time is of the thread running the stage, the lifecycle stages may run in parallel.
+ * The application closes the profile at UP, logs the slowest stages and writes the JSON
+ * if asked on the command line.
+ */
+struct startup_profile
+{
+    struct sample
+    {
+        std::string entity;
+        char const* stage; // a literal
+        int64_t wall_ns;
+        int64_t cpu_ns;
+    };
+
+    // measures the enclosing scope, exceptions included
+    struct scope
+    {
+        scope(startup_profile& profile, std::string entity, char const* stage);
+        ~scope();
+
+        scope(scope const&) = delete;
+        scope& operator=(scope const&) = delete;
+
+    private:
+        startup_profile& profile_;
+        std::string entity_;
+        char const* const stage_;
+        std::chrono::steady_clock::time_point const wall_begin_;
+        int64_t const cpu_begin_ns_;
+    };
+
+    // ignored once closed
+    void add(sample s);
+
+    // stops the recording, returns the samples in the order the stages completed
+    std::vector<sample> close();
+
+    static void write_json(std::ostream& out, std::vector<sample> const& samples);
+
+private:
+    std::mutex mutex_;
+    std::vector<sample> samples_;
+    bool closed_ {false};
+};
+
+} // namespace ufw
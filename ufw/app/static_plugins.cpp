@@ -0,0 +1,96 @@
+#include "static_plugins.hpp"
+
+#include "application.hpp"
+#include "exception_types.hpp"
+
+#include <map>
+#include <set>
+
+namespace ufw {
+
+namespace {
+
+struct static_plugin
+{
+    static_plugins::ctor_t ctor;
+    static_plugins::params_ctor_t params_ctor;
+};
+
+struct static_plugin_table
+{
+    std::map<std::string, static_plugin, std::less<>> plugins;
+    std::set<std::string, std::less<>> libraries;
+};
+
+// constructed on the first registration, whichever static initializer runs first
+static_plugin_table& table()
+{
+    static static_plugin_table instance;
+    return instance;
+}
+
+bool add(char const* const library, char const* const name, static_plugin const plugin) noexcept
+{
+    try
+    {
+        auto& t = table();
+        t.libraries.emplace(library);
+        return t.plugins.emplace(name, plugin).second;
+    }
+    catch (...)
+    {
+        return false;
+    }
+}
+
+} // local namespace
+
+bool static_plugins::add(char const* const library, char const* const name, ctor_t const ctor) noexcept
+{
+    return ufw::add(library, name, {ctor, nullptr});
+}
+
+bool static_plugins::add(char const* const library, char const* const name, params_ctor_t const ctor) noexcept
+{
+    return ufw::add(library, name, {nullptr, ctor});
+}
+
+bool static_plugins::contains(std::string_view const name) noexcept
+{
+    auto const& plugins = table().plugins;
+    return plugins.find(name) != plugins.end();
+}
+
+bool static_plugins::linked(std::string_view const library) noexcept
+{
+    auto const& libraries = table().libraries;
+    return libraries.find(library) != libraries.end();
+}
+
+std::unique_ptr<entity> static_plugins::construct(entity_id const& id, resolved_entity_id const rid, application& app, config_t const& cfg)
+{
+    auto const constructor = cfg["constructor"].as<std::string>();
+
+    auto const& plugins = table().plugins;
+    auto const it = plugins.find(constructor);
+    if (it == plugins.end())
+        throw fatal_error("no statically linked plugin constructor " + constructor + " for " + id);
+
+    auto const params = cfg["params"];
+    if (params ? !it->second.params_ctor : !it->second.ctor)
+        throw fatal_error("statically linked plugin constructor " + constructor + (params ? " takes no params" : " takes params") + ", check configuration of " + id);
+
+    startup_profile::scope const profiled {app.startup(), id, "construct"};
+    return std::unique_ptr<entity> {params ? it->second.params_ctor(id, rid, app, params) : it->second.ctor(id, rid, app)};
+}
+
+std::string_view static_plugins::library_stem(std::string_view filename) noexcept
+{
+    if (auto const slash = filename.rfind('/'); slash != std::string_view::npos)
+        filename.remove_prefix(slash + 1);
+    if (filename.starts_with("lib"))
+        filename.remove_prefix(3);
+    return filename.substr(0, filename.find('.'));
+}
+
+} // namespace ufw
@@ -0,0 +1,69 @@
+/* Copyright (c) 2026 Vladimir Lysyy (mrbald@github)
+ * ALv2 (http://www.apache.org/licenses/LICENSE-2.0)
+ */
+
+#pragma once
+
+#include "configuration.hpp"
+#include "entity.hpp"
+#include "loader.hpp"
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace ufw {
+
+/**
+ * Link-time table of the plugin constructors linked into the executable, filled by UFW_STATIC_PLUGIN
+ * from the static initializers, before main(), and read-only after.
+ *
+ * A statically linked plugin is constructed with the same config as from a shared library: LIBRARY
+ * does not dlopen a `filename` with the stem (libexample.so - example) of a statically linked plugin,
+ * and PLUGIN looks the `constructor` up here for such a `library_ref` only. The STATIC loader takes
+ * the constructor from here only.
+ */
+struct static_plugins
+{
+    using ctor_t = entity*(*)(entity_id const&, resolved_entity_id, application&);
+    using params_ctor_t = entity*(*)(entity_id const&, resolved_entity_id, application&, config_t const&);
+
+    // the first registration of a name wins
+    static bool add(char const* library, char const* name, ctor_t ctor) noexcept;
+    static bool add(char const* library, char const* name, params_ctor_t ctor) noexcept;
+
+    static bool contains(std::string_view name) noexcept;
+
+    // some plugin registered from the library stem
+    static bool linked(std::string_view library) noexcept;
+
+    // the `constructor`, with `params` if set
+    static std::unique_ptr<entity> construct(entity_id const& id, resolved_entity_id rid, application& app, config_t const& cfg);
+
+    // the file name without the directory, the lib prefix and the extensions
+    static std::string_view library_stem(std::string_view filename) noexcept;
+};
+
+struct static_plugin_repository final: loader
+{
+    using loader::loader;
+
+    std::unique_ptr<entity> load(entity_id const& id, resolved_entity_id rid, config_t const& cfg) override
+    {
+        return static_plugins::construct(id, rid, app(), cfg);
+    }
+};
+
+} // namespace ufw
+
+#define UFW_STATIC_PLUGIN_CAT_(a, b) a##b
+#define UFW_STATIC_PLUGIN_CAT(a, b) UFW_STATIC_PLUGIN_CAT_(a, b)
+
+// UFW_STATIC_PLUGIN(library stem, constructor) at the namespace scope of the plugin, registers in the
+// builds with UFW_STATIC_PLUGINS defined, the plugin shared libraries do not
+#ifdef UFW_STATIC_PLUGINS
+#define UFW_STATIC_PLUGIN(library, ctor) \
+    [[maybe_unused]] static bool const UFW_STATIC_PLUGIN_CAT(ufw_static_plugin_, __LINE__) = ::ufw::static_plugins::add(#library, #ctor, &ctor)
+#else
+#define UFW_STATIC_PLUGIN(library, ctor) static_assert(true)
+#endif
@@ -0,0 +1,140 @@
+/* Copyright (c) 2026 Vladimir Lysyy (mrbald@github)
+ * ALv2 (http://www.apache.org/licenses/LICENSE-2.0)
+ */
+
+#pragma once
+
+#include "handler_memory.hpp"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace ufw {
+
+/**
+ * Move-only type-erased `void()` callable with a small buffer, a replacement for
+ * std::function where the callable is posted once and then invoked once.
+ *
+ * Callables up to inline_size bytes with a noexcept move are stored inline, larger
+ * ones are allocated from the handler memory.
+ */
+struct task
+{
+    static constexpr size_t inline_size = 48;
+
+    task() noexcept = default;
+
+    template <class F, class = std::enable_if_t<!std::is_same_v<std::decay_t<F>, task>>>
+    task(F&& f)
+    {
+        using callable = std::decay_t<F>;
+
+        if constexpr (is_inline<callable>)
+        {
+            ::new (static_cast<void*>(storage_)) callable(std::forward<F>(f));
+            vtable_ = &inline_vtable<callable>;
+        }
+        else
+        {
+            void* const p = handler_memory::allocate(sizeof(callable));
+            try
+            {
+                heap_ = ::new (p) callable(std::forward<F>(f));
+            }
+            catch (...)
+            {
+                handler_memory::deallocate(p, sizeof(callable));
+                throw;
+            }
+            vtable_ = &heap_vtable<callable>;
+        }
+    }
+
+    task(task&& rhs) noexcept: vtable_ {rhs.vtable_}
+    {
+        if (vtable_)
+            vtable_->move(*this, rhs);
+        rhs.vtable_ = nullptr;
+    }
+
+    task& operator=(task&& rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            reset();
+            vtable_ = rhs.vtable_;
+            if (vtable_)
+                vtable_->move(*this, rhs);
+            rhs.vtable_ = nullptr;
+        }
+        return *this;
+    }
+
+    task(task const&) = delete;
+    task& operator=(task const&) = delete;
+
+    ~task() { reset(); }
+
+    void operator()() { vtable_->invoke(*this); }
+
+    explicit operator bool() const noexcept { return vtable_; }
+
+private:
+    struct vtable_t
+    {
+        void (*invoke)(task&);
+        void (*move)(task& to, task& from) noexcept;
+        void (*destroy)(task&) noexcept;
+    };
+
+    // ahead of the vtables below, their initializers are not a complete-class context
+    union
+    {
+        alignas(std::max_align_t) unsigned char storage_[inline_size];
+        void* heap_;
+    };
+    vtable_t const* vtable_ {};
+
+    template <class F>
+    static constexpr bool is_inline = sizeof(F) <= inline_size
+            && alignof(F) <= alignof(std::max_align_t)
+            && std::is_nothrow_move_constructible_v<F>;
+
+    template <class F>
+    static F& inline_target(task& t) noexcept { return *std::launder(reinterpret_cast<F*>(t.storage_)); }
+
+    template <class F>
+    static constexpr vtable_t inline_vtable {
+        [](task& t) { inline_target<F>(t)(); },
+        [](task& to, task& from) noexcept
+        {
+            ::new (static_cast<void*>(to.storage_)) F(std::move(inline_target<F>(from)));
+            inline_target<F>(from).~F();
+        },
+        [](task& t) noexcept { inline_target<F>(t).~F(); }
+    };
+
+    template <class F>
+    static constexpr vtable_t heap_vtable {
+        [](task& t) { (*static_cast<F*>(t.heap_))(); },
+        [](task& to, task& from) noexcept { to.heap_ = from.heap_; },
+        [](task& t) noexcept
+        {
+            static_cast<F*>(t.heap_)->~F();
+            handler_memory::deallocate(t.heap_, sizeof(F));
+        }
+    };
+
+    void reset() noexcept
+    {
+        if (vtable_)
+        {
+            vtable_->destroy(*this);
+            vtable_ = nullptr;
+        }
+    }
+};
+
+} // namespace ufw
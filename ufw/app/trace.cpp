@@ -0,0 +1,177 @@
+#include "trace.hpp"
+
+#include "clock.hpp"
+#include "logger.hpp"
+
+#include <boost/core/demangle.hpp>
+
+#include <array>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace ufw {
+
+std::atomic<bool> tracer::enabled_ {false};
+std::atomic<uint64_t> tracer::recording_ {0};
+
+namespace {
+
+struct trace_event
+{
+    uint64_t recording;
+    int64_t ts_ns;
+    char const* name;
+    char const* detail;
+    char phase;
+    bool type_name;
+};
+
+// written by the owner thread, drained by the flush under the registry mutex
+struct trace_ring
+{
+    static constexpr size_t capacity = size_t {1} << 15;
+
+    explicit trace_ring(uint64_t const tid): tid {tid} {}
+
+    void push(trace_event const& e) noexcept
+    {
+        auto const head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) == capacity)
+        {
+            dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        events_[head % capacity] = e;
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    template <class F>
+    size_t drain(F&& f)
+    {
+        auto const tail = tail_.load(std::memory_order_relaxed);
+        auto const head = head_.load(std::memory_order_acquire);
+        for (auto i = tail; i != head; ++i)
+            f(events_[i % capacity]);
+        tail_.store(head, std::memory_order_release);
+        return head - tail;
+    }
+
+    uint64_t const tid;
+    std::atomic<uint64_t> dropped {0};
+
+private:
+    alignas(64) std::atomic<uint64_t> head_ {0};
+    alignas(64) std::atomic<uint64_t> tail_ {0};
+    std::array<trace_event, capacity> events_;
+};
+
+struct trace_registry
+{
+    std::mutex mutex;
+    std::vector<std::unique_ptr<trace_ring>> rings; // of exited threads too, to flush their events
+};
+
+trace_registry& registry()
+{
+    static trace_registry instance;
+    return instance;
+}
+
+trace_ring* local_ring() noexcept
+{
+    thread_local trace_ring* ring = nullptr;
+    if (!ring) [[unlikely]]
+    {
+        try
+        {
+            auto& r = registry();
+            std::lock_guard<std::mutex> lock {r.mutex};
+            r.rings.push_back(std::make_unique<trace_ring>(get_tid()));
+            ring = r.rings.back().get();
+        }
+        catch (...)
+        {
+            // no memory for the ring, the event is lost
+        }
+    }
+    return ring;
+}
+
+// the names are literals, type names and entity IDs, no control characters expected
+void write_json_string(std::ostream& out, std::string const& s)
+{
+    for (char const c: s)
+    {
+        if (c == '"' || c == '\\')
+            out << '\\';
+        out << c;
+    }
+}
+
+} // local namespace
+
+void tracer::enable(bool const on) noexcept
+{
+    if (on && !enabled())
+        recording_.fetch_add(1, std::memory_order_relaxed);
+    enabled_.store(on, std::memory_order_relaxed);
+}
+
+void tracer::record(char const phase, char const* const name, char const* const detail, bool const type_name) noexcept
+{
+    if (auto* ring = local_ring())
+        ring->push({recording(), tsc_clock::monotonic_ns(), name, detail, phase, type_name});
+}
+
+size_t tracer::flush(std::ostream& out, bool first)
+{
+    auto const pid = ::getpid();
+
+    auto const current = recording();
+
+    auto& r = registry();
+    std::lock_guard<std::mutex> lock {r.mutex};
+
+    size_t written = 0;
+    for (auto const& ring: r.rings)
+    {
+        ring->drain([&](trace_event const& e)
+        {
+            // late events of a past recording, their names and details may be gone
+            if (e.recording != current)
+                return;
+
+            ++written;
+            out << (first ? "" : ",\n") << "{\"name\":\"";
+            first = false;
+            write_json_string(out, e.type_name ? boost::core::demangle(e.name) : std::string {e.name});
+            if (e.detail)
+            {
+                out << ' ';
+                write_json_string(out, e.detail);
+            }
+            out << "\",\"cat\":\"ufw\",\"ph\":\"" << e.phase << "\",\"ts\":" << e.ts_ns / 1000 << '.'
+                << std::setw(3) << std::setfill('0') << e.ts_ns % 1000 << std::setfill(' ')
+                << ",\"pid\":" << pid << ",\"tid\":" << ring->tid << '}';
+        });
+    }
+    return written;
+}
+
+uint64_t tracer::dropped() noexcept
+{
+    auto& r = registry();
+    std::lock_guard<std::mutex> lock {r.mutex};
+
+    uint64_t n = 0;
+    for (auto const& ring: r.rings)
+        n += ring->dropped.load(std::memory_order_relaxed);
+    return n;
+}
+
+} // namespace ufw
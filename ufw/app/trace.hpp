@@ -0,0 +1,90 @@
+/* Copyright (c) 2026 Vladimir Lysyy (mrbald@github)
+ * ALv2 (http://www.apache.org/licenses/LICENSE-2.0)
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+namespace ufw {
+
+/**
+ * Process-wide begin/end event recorder for the Chrome trace_event format, which Perfetto
+ * and chrome://tracing open. The events go to per-thread single producer rings with no locks
+ * on the recording side, flush() drains them as JSON. A full ring drops the events.
+ *
+ * The framework traces entity loading, the lifecycle stages, the inbox drains, the timed
+ * handlers and the dispatcher publishes, with UFW_TRACE_SCOPE compiled in by the UFW_TRACE
+ * build option only. The TRACE entity (see trace_service.hpp) turns the recording on and
+ * writes the file.
+ */
+struct tracer
+{
+    static bool enabled() noexcept { return enabled_.load(std::memory_order_relaxed); }
+
+    // each enabling starts a new recording, flush() writes the events of the last one only
+    static void enable(bool on) noexcept;
+
+    // of the last recording, 0 before the first one
+    static uint64_t recording() noexcept { return recording_.load(std::memory_order_relaxed); }
+
+    // the name and the detail are not copied and must outlive the flush - literals, type names
+    // (demangled on flush), entity IDs
+    static void record(char phase, char const* name, char const* detail, bool type_name) noexcept;
+
+    // appends the events recorded since the last flush to a JSON array, the first written one
+    // with no leading comma if `first`, returns the number written
+    static size_t flush(std::ostream& out, bool first);
+
+    // lost to the full rings since the start
+    static uint64_t dropped() noexcept;
+
+private:
+    static std::atomic<bool> enabled_;
+    static std::atomic<uint64_t> recording_;
+};
+
+// records the begin and, if it did and the recording is still on, the end event on the same thread
+struct trace_scope
+{
+    explicit trace_scope(char const* const name, char const* const detail = nullptr, bool const type_name = false) noexcept:
+        name_ {name},
+        detail_ {detail},
+        type_name_ {type_name},
+        recording_ {tracer::enabled() ? tracer::recording() : 0}
+    {
+        if (recording_)
+            tracer::record('B', name_, detail_, type_name_);
+    }
+
+    ~trace_scope()
+    {
+        // the detail may be gone with the application that stopped the recording
+        if (recording_ && tracer::enabled() && tracer::recording() == recording_)
+            tracer::record('E', name_, detail_, type_name_);
+    }
+
+    trace_scope(trace_scope const&) = delete;
+    trace_scope& operator=(trace_scope const&) = delete;
+
+private:
+    char const* const name_;
+    char const* const detail_;
+    bool const type_name_;
+    uint64_t const recording_; // 0 - not recorded
+};
+
+} // namespace ufw
+
+#define UFW_TRACE_CAT_(a, b) a##b
+#define UFW_TRACE_CAT(a, b) UFW_TRACE_CAT_(a, b)
+
+// UFW_TRACE_SCOPE(name [, detail [, type_name]]), the arguments are not evaluated when compiled out
+#ifdef UFW_TRACE
+#define UFW_TRACE_SCOPE(...) ::ufw::trace_scope const UFW_TRACE_CAT(ufw_trace_scope_, __LINE__) {__VA_ARGS__}
+#else
+#define UFW_TRACE_SCOPE(...) static_cast<void>(0)
+#endif
@@ -0,0 +1,102 @@
+#include "trace_service.hpp"
+
+#include "application.hpp"
+
+#include <csignal>
+
+namespace ufw {
+
+trace_service::trace_service(config_t const& cfg, entity_id const& id, resolved_entity_id rid, application& app):
+    entity {id, rid, app},
+    path_ {cfg["path"] ? cfg["path"].as<std::string>() : std::string {"ufw-trace.json"}},
+    flush_interval_ {cfg["flush_interval_ms"] ? cfg["flush_interval_ms"].as<int64_t>() : 1000},
+    timer_ {context().get_executor()},
+    toggle_signals_ {app.context(), SIGUSR2},
+    out_ {path_, std::ios::trunc}
+{
+    if (!out_)
+        throw fatal_error("cannot open trace file " + path_);
+    out_ << "[\n";
+
+#ifndef UFW_TRACE
+    LOG_WRN << "built without UFW_TRACE, " << path_ << " will have no events";
+#endif
+
+    if (!cfg["enabled"] || cfg["enabled"].as<bool>())
+        tracer::enable(true);
+}
+
+void trace_service::start()
+{
+    LOG_INF << "tracing to " << path_ << (tracer::enabled() ? "" : " once enabled") << ", SIGUSR2 toggles";
+    await_toggle();
+    app().post(*this, [this] { schedule_flush(); });
+}
+
+void trace_service::stop() noexcept
+{
+    // the execution contexts are stopped by now, the events of the remaining stages are flushed at fini()
+    timer_.cancel();
+    boost::system::error_code ec;
+    toggle_signals_.cancel(ec);
+}
+
+void trace_service::fini() noexcept
+{
+    tracer::enable(false);
+    flush();
+
+    std::lock_guard<std::mutex> lock {mutex_};
+    out_ << "\n]\n";
+    out_.close();
+
+    if (auto const dropped = tracer::dropped())
+    {
+        LOG_WRN << dropped << " trace events dropped on full buffers";
+    }
+}
+
+void trace_service::schedule_flush()
+{
+    timer_.expires_after(flush_interval_);
+    timer_.async_wait(recycling([this](boost::system::error_code const& ec)
+    {
+        if (ec)
+            return;
+        flush();
+        schedule_flush();
+    }));
+}
+
+void trace_service::await_toggle()
+{
+    toggle_signals_.async_wait([this](boost::system::error_code const& ec, int)
+    {
+        if (ec)
+            return;
+
+        auto const on = !tracer::enabled();
+        tracer::enable(on);
+        LOG_INF << "tracing " << (on ? "enabled" : "disabled");
+        if (!on)
+            flush();
+        await_toggle();
+    });
+}
+
+void trace_service::flush() noexcept
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    try
+    {
+        if (tracer::flush(out_, first_))
+            first_ = false;
+        out_.flush();
+    }
+    catch (std::exception const& ex)
+    {
+        LOG_ERR_RATE_LIMITED(1, 1) << "failed to write trace events to " << path_ << ": " << ex.what();
+    }
+}
+
+} // namespace ufw
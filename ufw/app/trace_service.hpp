@@ -0,0 +1,52 @@
+/* Copyright (c) 2026 Vladimir Lysyy (mrbald@github)
+ * ALv2 (http://www.apache.org/licenses/LICENSE-2.0)
+ */
+
+#pragma once
+
+#include "configuration.hpp"
+#include "entity.hpp"
+#include "lifecycle_participant.hpp"
+#include "trace.hpp"
+
+#include <boost/asio/signal_set.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+namespace ufw {
+
+/**
+ * The TRACE entity, writes the tracer events to `path` (ufw-trace.json by default) as a Chrome
+ * trace_event JSON array every `flush_interval_ms` (1000 by default) and at fini(). Recording
+ * starts at construction if `enabled` (true by default), SIGUSR2 toggles it. Declared first, it
+ * captures the loading of the other entities and, finalized last, their stop() and fini().
+ * Records nothing unless built with UFW_TRACE.
+ */
+struct trace_service: entity, lifecycle_participant
+{
+    trace_service(config_t const& cfg, entity_id const& id, resolved_entity_id rid, application& app);
+
+    void start() override;
+    void stop() noexcept override;
+    void fini() noexcept override;
+
+private:
+    void schedule_flush();
+    void await_toggle();
+    void flush() noexcept;
+
+    std::string const path_;
+    std::chrono::milliseconds const flush_interval_;
+    boost::asio::steady_timer timer_;
+    boost::asio::signal_set toggle_signals_;
+
+    std::mutex mutex_; // the timer and the signal handlers may run on different threads
+    std::ofstream out_;
+    bool first_ {true};
+};
+
+} // namespace ufw
@@ -0,0 +1,225 @@
+#include "work_stealing_pool.hpp"
+
+#include "exception_types.hpp"
+#include "execution_context.hpp"
+#include "logger.hpp"
+
+#include <random>
+
+namespace ufw {
+
+struct work_stealing_pool::worker
+{
+    worker(size_t index, size_t deque_capacity): index {index}, tasks {deque_capacity}, inbox {deque_capacity, false} {}
+
+    size_t const index;
+    work_stealing_deque<task> tasks;
+    ring<task*> inbox; // submits from outside the pool
+    std::atomic_flag draining; // the inbox consumer, any idle worker may take it
+    std::minstd_rand random {uint32_t(index + 1)};
+    std::thread thread;
+};
+
+namespace {
+
+// the worker the current thread runs, if any, to route submits from within the pool to the local deque
+thread_local work_stealing_pool const* current_pool = nullptr;
+thread_local void* current_worker = nullptr;
+
+// the next inbox an outside thread submits to, seeded apart so the submitters do not start on the same worker
+thread_local size_t submit_cursor = std::hash<std::thread::id> {}(std::this_thread::get_id());
+
+constexpr size_t spin_rounds = 64; // idle find_task() rounds before parking
+
+} // local namespace
+
+work_stealing_pool::work_stealing_pool(size_t const threads, std::vector<int> cpus, error_handler_t on_error,
+        size_t const deque_capacity):
+    cpus_ {std::move(cpus)},
+    on_error_ {std::move(on_error)}
+{
+    if (!threads)
+        throw fatal_error("work stealing pool needs at least one thread");
+
+    workers_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i)
+        workers_.push_back(std::make_unique<worker>(i, deque_capacity));
+}
+
+work_stealing_pool::~work_stealing_pool()
+{
+    stop();
+    shutdown(); // destroy the asio services (timers, ...) before the queues go away
+    destroy();
+
+    for (auto& w: workers_)
+    {
+        while (task* const t = w->tasks.pop()) delete t;
+        w->inbox.drain([](task* t) { delete t; }, w->inbox.capacity());
+    }
+    for (task* const t: overflow_)
+        delete t;
+}
+
+void work_stealing_pool::start()
+{
+    stopped_.store(false, std::memory_order_seq_cst);
+    for (auto& w: workers_)
+        w->thread = std::thread {[this, &w = *w] { run(w); }};
+}
+
+void work_stealing_pool::stop() noexcept
+{
+    stopped_.store(true, std::memory_order_seq_cst);
+    wake_epoch_.fetch_add(1, std::memory_order_seq_cst);
+    wake_epoch_.notify_all();
+
+    for (auto& w: workers_)
+        if (w->thread.joinable()) w->thread.join();
+}
+
+void work_stealing_pool::submit(task* const t)
+{
+    // counted ahead of the push so a worker never parks with a task in flight, pairs with
+    // the sleeping_ increment in park() - one of the two sides sees the other
+    queued_.fetch_add(1, std::memory_order_seq_cst);
+
+    if (current_pool != this || !static_cast<worker*>(current_worker)->tasks.push(t))
+    {
+        auto const n = workers_.size();
+        auto const first = submit_cursor++;
+        size_t i = 0;
+        for (task* x = t; i < n; ++i)
+            if (workers_[(first + i) % n]->inbox.try_push(std::move(x)))
+                break;
+
+        if (i == n)
+        {
+            std::lock_guard<std::mutex> lock {mutex_};
+            overflow_.push_back(t); // all the inboxes are full
+            overflowed_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (sleeping_.load(std::memory_order_seq_cst))
+        wake();
+}
+
+void work_stealing_pool::wake() noexcept
+{
+    // a parking worker read the epoch before its queued_ check, so it either sees the task or this bump
+    wake_epoch_.fetch_add(1, std::memory_order_seq_cst);
+    wake_epoch_.notify_one();
+}
+
+work_stealing_pool::task* work_stealing_pool::take_injected(worker& w) noexcept
+{
+    if (w.inbox.empty() || w.draining.test_and_set(std::memory_order_acquire))
+        return nullptr;
+
+    task* t = nullptr;
+    w.inbox.drain([&t](task* x) { t = x; }, 1);
+    w.draining.clear(std::memory_order_release);
+    return t;
+}
+
+work_stealing_pool::task* work_stealing_pool::find_task(worker& w)
+{
+    if (task* const t = w.tasks.pop())
+        return t;
+
+    if (task* const t = take_injected(w))
+        return t;
+
+    auto const n = workers_.size();
+    if (n > 1)
+    {
+        auto const first = w.random() % n;
+        for (size_t i = 0; i < n; ++i)
+        {
+            auto& victim = *workers_[(first + i) % n];
+            if (&victim == &w) continue;
+            if (task* const t = victim.tasks.steal())
+                return t;
+            if (task* const t = take_injected(victim))
+                return t;
+        }
+    }
+
+    if (overflowed_.load(std::memory_order_relaxed))
+    {
+        std::unique_lock<std::mutex> lock {mutex_, std::try_to_lock};
+        if (lock && !overflow_.empty())
+        {
+            task* const t = overflow_.front();
+            overflow_.pop_front();
+            overflowed_.fetch_sub(1, std::memory_order_relaxed);
+            return t;
+        }
+    }
+
+    return nullptr;
+}
+
+void work_stealing_pool::park()
+{
+    auto const epoch = wake_epoch_.load(std::memory_order_seq_cst);
+    sleeping_.fetch_add(1, std::memory_order_seq_cst);
+    if (!queued_.load(std::memory_order_seq_cst) && !stopped_.load(std::memory_order_seq_cst))
+        wake_epoch_.wait(epoch, std::memory_order_seq_cst);
+    sleeping_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void work_stealing_pool::run(worker& w)
+{
+    LOG_STAMP_THREAD;
+
+    current_pool = this;
+    current_worker = &w;
+
+    if (!cpus_.empty())
+    {
+        auto const cpu = cpus_[w.index % cpus_.size()];
+        if (pin_current_thread(cpu))
+            LOG_INF << "work stealing pool worker " << w.index << " pinned to CPU " << cpu;
+        else
+            LOG_WRN << "failed to pin work stealing pool worker " << w.index << " to CPU " << cpu;
+    }
+
+    size_t idle = 0;
+    while (!stopped_.load(std::memory_order_relaxed))
+    {
+        task* const t = find_task(w);
+        if (!t)
+        {
+            if (++idle < spin_rounds)
+                cpu_relax();
+            else
+            {
+                park();
+                idle = 0;
+            }
+            continue;
+        }
+
+        idle = 0;
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+
+        std::unique_ptr<task> const guard {t};
+        try
+        {
+            t->run();
+        }
+        catch (std::exception const& e)
+        {
+            LOG_ERR << "unhandled exception in work stealing pool worker " << w.index << ": " << e.what();
+            if (on_error_) on_error_(std::current_exception());
+            break;
+        }
+    }
+
+    current_pool = nullptr;
+    current_worker = nullptr;
+}
+
+} // namespace ufw
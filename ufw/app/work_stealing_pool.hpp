@@ -0,0 +1,195 @@
+/* Copyright (c) 2026 Vladimir Lysyy (mrbald@github)
+ * ALv2 (http://www.apache.org/licenses/LICENSE-2.0)
+ */
+
+#pragma once
+
+#include "handler_memory.hpp"
+#include "inbox.hpp"
+
+#include <boost/asio/execution.hpp>
+#include <boost/asio/execution_context.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ufw {
+
+/**
+ * Fixed capacity Chase-Lev work-stealing deque (the C11 formulation by Le et al.).
+ *
+ * The owner pushes and pops at the bottom, thieves steal from the top.
+ */
+template <class T>
+struct work_stealing_deque
+{
+    explicit work_stealing_deque(size_t capacity):
+        mask_ {std::bit_ceil(std::max<size_t>(capacity, 2)) - 1},
+        buffer_ {new std::atomic<T*>[mask_ + 1]} {}
+
+    // owner only, false if full
+    bool push(T* const x) noexcept
+    {
+        auto const b = bottom_.load(std::memory_order_relaxed);
+        auto const t = top_.load(std::memory_order_acquire);
+        if (b - t > int64_t(mask_))
+            return false;
+
+        buffer_[b & mask_].store(x, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // owner only
+    T* pop() noexcept
+    {
+        auto const b = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto t = top_.load(std::memory_order_relaxed);
+
+        if (t > b)
+        {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        T* x = buffer_[b & mask_].load(std::memory_order_relaxed);
+        if (t == b)
+        {
+            // the last one, race against the thieves
+            if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                x = nullptr;
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return x;
+    }
+
+    // any thread
+    T* steal() noexcept
+    {
+        auto t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto const b = bottom_.load(std::memory_order_acquire);
+        if (t >= b)
+            return nullptr;
+
+        T* const x = buffer_[t & mask_].load(std::memory_order_relaxed);
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr; // lost the race, the caller moves on to another victim
+        return x;
+    }
+
+private:
+    size_t const mask_;
+    std::unique_ptr<std::atomic<T*>[]> const buffer_;
+
+    alignas(cache_line_size) std::atomic<int64_t> top_ {0};
+    alignas(cache_line_size) std::atomic<int64_t> bottom_ {0};
+};
+
+/**
+ * Work-stealing thread pool with per-worker Chase-Lev deques and random victim stealing.
+ *
+ * Tasks submitted from a worker go to its own deque, tasks from other threads go to the
+ * worker MPSC inboxes round robin, a mutex guarded overflow queue takes them only when
+ * all the inboxes are full. Idle workers steal from the deques and the inboxes, then
+ * park on an atomic wake epoch, so neither submitting nor waking takes a lock.
+ * The pool is an asio execution_context and get_executor() returns a standard executor,
+ * so asio post(), timers and strands work on top of it.
+ */
+struct work_stealing_pool: boost::asio::execution_context
+{
+    struct task
+    {
+        virtual void run() = 0;
+        virtual ~task() = default;
+
+        static void* operator new(size_t size) { return handler_memory::allocate(size); }
+        static void operator delete(void* p, size_t size) noexcept { handler_memory::deallocate(p, size); }
+    };
+
+    using error_handler_t = std::function<void(std::exception_ptr)>;
+
+    work_stealing_pool(size_t threads, std::vector<int> cpus = {}, error_handler_t on_error = {}, size_t deque_capacity = 4096);
+    ~work_stealing_pool();
+
+    void start();
+    void stop() noexcept;
+
+    size_t size() const noexcept { return workers_.size(); }
+
+    // takes ownership
+    void submit(task* t);
+
+    template <class F>
+    void submit(F&& f)
+    {
+        struct task_impl final: task
+        {
+            explicit task_impl(F&& f): f_ {std::forward<F>(f)} {}
+            void run() override { std::move(f_)(); }
+            std::decay_t<F> f_;
+        };
+        submit(static_cast<task*>(new task_impl {std::forward<F>(f)}));
+    }
+
+    struct executor_type
+    {
+        explicit executor_type(work_stealing_pool& pool) noexcept: pool_ {&pool} {}
+
+        template <class F>
+        void execute(F&& f) const { pool_->submit(std::forward<F>(f)); }
+
+        work_stealing_pool& query(boost::asio::execution::context_t) const noexcept { return *pool_; }
+
+        static constexpr boost::asio::execution::blocking_t query(boost::asio::execution::blocking_t) noexcept
+        {
+            return boost::asio::execution::blocking.never;
+        }
+
+        executor_type require(boost::asio::execution::blocking_t::never_t) const noexcept { return *this; }
+
+        friend bool operator==(executor_type const& l, executor_type const& r) noexcept { return l.pool_ == r.pool_; }
+        friend bool operator!=(executor_type const& l, executor_type const& r) noexcept { return l.pool_ != r.pool_; }
+
+    private:
+        work_stealing_pool* pool_;
+    };
+
+    executor_type get_executor() noexcept { return executor_type {*this}; }
+
+private:
+    struct worker;
+
+    void run(worker& w);
+    task* find_task(worker& w);
+    void park();
+    void wake() noexcept;
+    task* take_injected(worker& w) noexcept;
+
+    std::vector<int> const cpus_;
+    error_handler_t const on_error_;
+
+    std::vector<std::unique_ptr<worker>> workers_;
+
+    std::mutex mutex_; // the overflow queue
+    std::deque<task*> overflow_;
+    std::atomic<size_t> overflowed_ {0};
+
+    alignas(cache_line_size) std::atomic<size_t> queued_ {0};
+    alignas(cache_line_size) std::atomic<size_t> sleeping_ {0};
+    std::atomic<uint32_t> wake_epoch_ {0};
+    std::atomic<bool> stopped_ {true};
+};
+
+} // namespace ufw
@@ -0,0 +1,58 @@
+#include "dispatcher.hpp"
+
+#include <ufw/app/logger.hpp>
+
+#include <algorithm>
+#include <bit>
+
+namespace ufw {
+
+void dispatcher::subscribe(topic_id_t const topic_id, handler_t handler)
+{
+    if (app().structure_locked())
+        throw fatal_error("cannot subscribe - application structure already locked, likely a bug in the code");
+
+    pending_.emplace_back(topic_id, std::move(handler));
+}
+
+void dispatcher::init()
+{
+    verify_topic_ids();
+
+    // stable to keep handlers in the subscription order within a topic
+    std::stable_sort(begin(pending_), end(pending_), [](auto const& l, auto const& r) { return l.first < r.first; });
+
+    size_t topics = 0;
+    for (size_t i = 0; i < pending_.size(); ++i)
+        if (!i || pending_[i].first != pending_[i - 1].first) ++topics;
+
+    // load factor at most 1/2 keeps the probe sequences short
+    size_t const capacity = std::bit_ceil(std::max<size_t>(2 * topics, 2));
+    slots_.assign(capacity, slot {0, 0, 0});
+    mask_ = capacity - 1;
+    shift_ = 64 - std::countr_zero(capacity);
+
+    handlers_.clear();
+    handlers_.reserve(pending_.size());
+
+    for (auto& [topic_id, handler]: pending_)
+    {
+        size_t i = index_of(topic_id);
+        while (slots_[i].topic_id && slots_[i].topic_id != topic_id)
+            i = (i + 1) & mask_;
+
+        slot& s = slots_[i];
+        if (!s.topic_id)
+            s = slot {topic_id, uint32_t(handlers_.size()), uint32_t(handlers_.size())};
+
+        handlers_.push_back(std::move(handler));
+        ++s.end;
+    }
+
+    pending_.clear();
+    pending_.shrink_to_fit();
+
+    LOG_INF << "compiled " << handlers_.size() << " subscriptions to " << topics << " topics";
+}
+
+} // namespace ufw
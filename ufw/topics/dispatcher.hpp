@@ -0,0 +1,113 @@
+/* Copyright (c) 2026 Vladimir Lysyy (mrbald@github)
+ * ALv2 (http://www.apache.org/licenses/LICENSE-2.0)
+ */
+
+#pragma once
+
+#include "topics.hpp"
+
+#include <ufw/app/application.hpp>
+#include <ufw/app/entity.hpp>
+#include <ufw/app/exception_types.hpp>
+#include <ufw/app/lifecycle_participant.hpp>
+#include <ufw/app/trace.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ufw {
+
+/**
+ * In-process typed publish/subscribe engine.
+ *
+ * Subscriptions are accepted while the application structure is open, that is
+ * from entity constructors during application::load(), so the dispatcher must be
+ * declared before its subscribers. In init() the subscriptions are compiled into
+ * a flat open-addressing table keyed by topic_id_t, each slot referring to a
+ * contiguous span of handlers. A publish() is one probe plus a loop over that span,
+ * with no locks and no allocations.
+ */
+struct dispatcher: entity, lifecycle_participant
+{
+    using handler_t = std::function<void(void const*)>;
+
+    using entity::entity;
+
+    template <typename T, typename F>
+    void subscribe(std::string const& subject, F&& f)
+    {
+        subscribe<T>(topic_id_for<T>(subject), std::forward<F>(f));
+    }
+
+    template <typename T, typename F>
+    void subscribe(topic_id_t const topic_id, F&& f)
+    {
+        static_assert(std::is_invocable_v<std::decay_t<F>&, T const&>, "handler must be callable with T const&");
+
+        subscribe(topic_id, handler_t {[f = std::forward<F>(f)](void const* msg) mutable
+        {
+            f(*static_cast<T const*>(msg));
+        }});
+    }
+
+    // topic_id must come from topic_id_for<T>(), the payload type is not checked here
+    template <typename T>
+    void publish(topic_id_t const topic_id, T const& msg) const
+    {
+        slot const* const s = find(topic_id);
+        if (!s) return;
+
+        UFW_TRACE_SCOPE("publish", id().c_str());
+        for (auto* it = handlers_.data() + s->begin, *end = handlers_.data() + s->end; it != end; ++it)
+            (*it)(&msg);
+    }
+
+    // number of handlers subscribed to the topic, valid after init()
+    size_t subscribers(topic_id_t const topic_id) const noexcept
+    {
+        slot const* const s = find(topic_id);
+        return s ? s->end - s->begin : 0;
+    }
+
+    void init() override; /* from lifecycle_participant */
+
+private:
+    void subscribe(topic_id_t topic_id, handler_t handler);
+
+    struct slot
+    {
+        topic_id_t topic_id; // zero for an empty slot, valid topic IDs are never zero
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    size_t index_of(topic_id_t const topic_id) const noexcept
+    {
+        return (topic_id * UINT64_C(0x9E3779B97F4A7C15)) >> shift_; // Fibonacci hashing
+    }
+
+    slot const* find(topic_id_t const topic_id) const noexcept
+    {
+        if (slots_.empty()) return nullptr;
+
+        for (size_t i = index_of(topic_id);; i = (i + 1) & mask_)
+        {
+            slot const& s = slots_[i];
+            if (s.topic_id == topic_id) return &s;
+            if (!s.topic_id) return nullptr;
+        }
+    }
+
+    std::vector<std::pair<topic_id_t, handler_t>> pending_;
+
+    std::vector<slot> slots_;
+    std::vector<handler_t> handlers_;
+    size_t mask_ {0};
+    unsigned shift_ {64};
+};
+
+} // namespace ufw
@@ -1,10 +1,145 @@
 #include "topics.hpp"
 
+#include <functional>
+#include <map>
+
 namespace ufw {
 
-topic_payload_id_t next_topic_payload_id() {
-    static topic_payload_id_t topic_payload_id_seq {0};
-    return ++topic_payload_id_seq;
+namespace {
+
+struct topic_payloads {
+    std::mutex mutex;
+    std::map<topic_payload_id_t, std::pair<std::string, std::string>> names; // ID -> (name, pretty name)
+    std::vector<std::string> collisions;
+};
+
+topic_payloads& payloads() {
+    static topic_payloads instance;
+    return instance;
+}
+
+} // local namespace
+
+topic_subject_interner& topic_subjects() {
+    static topic_subject_interner instance;
+    return instance;
+}
+
+std::string register_topic_payload(topic_payload_id_t const id, std::string_view const name, std::string const& pretty_name) {
+    auto& x = payloads();
+    std::lock_guard<std::mutex> lock {x.mutex};
+
+    auto const status = x.names.try_emplace(id, std::string(name), pretty_name);
+    if (status.second || status.first->second.first == name)
+        return {};
+
+    x.collisions.push_back("payload type [" + pretty_name + "] collides with ["
+            + status.first->second.second + "] - ID " + std::to_string(id));
+    return status.first->second.second;
+}
+
+bool register_static_topic(std::string_view const subject, topic_payload_id_t const payload_id,
+        std::string_view const payload_name, std::string const& pretty_name) noexcept {
+    try {
+        register_topic_payload(payload_id, payload_name, pretty_name);
+        return topic_subjects().insert(subject) != 0;
+    } catch (...) {
+        return false; // allocation failure during static initialization, nothing sensible to do
+    }
+}
+
+void verify_topic_ids() {
+    std::vector<std::string> collisions;
+    {
+        auto& x = payloads();
+        std::lock_guard<std::mutex> lock {x.mutex};
+        collisions = x.collisions;
+    }
+
+    for (auto& x: topic_subjects().collisions())
+        collisions.push_back(std::move(x));
+
+    if (collisions.empty())
+        return;
+
+    std::string what = "topic ID hash collisions detected:";
+    for (auto const& x: collisions)
+        what += " " + x + ";";
+    throw fatal_error(what);
+}
+
+topic_subject_interner::table::table(size_t const capacity):
+    mask {capacity - 1},
+    slots {new std::atomic<entry const*>[capacity]}
+{
+    for (size_t i = 0; i < capacity; ++i)
+        slots[i].store(nullptr, std::memory_order_relaxed);
+}
+
+topic_subject_interner::topic_subject_interner() {
+    tables_.push_back(std::make_unique<table>(64));
+    table_.store(tables_.back().get(), std::memory_order_release);
+}
+
+topic_subject_interner::~topic_subject_interner() = default;
+
+std::atomic<topic_subject_interner::entry const*>& topic_subject_interner::probe(
+        table const& t, std::string_view const subject, size_t const hash) noexcept {
+    for (size_t i = hash & t.mask;; i = (i + 1) & t.mask) {
+        auto& slot = t.slots[i];
+        entry const* const e = slot.load(std::memory_order_acquire);
+        if (!e || (e->hash == hash && e->subject == subject))
+            return slot;
+    }
+}
+
+topic_subject_id_t topic_subject_interner::find(std::string_view const subject) const noexcept {
+    table const& t = *table_.load(std::memory_order_acquire);
+    entry const* const e = probe(t, subject, std::hash<std::string_view>{}(subject)).load(std::memory_order_acquire);
+    return e ? e->id : 0;
+}
+
+topic_subject_id_t topic_subject_interner::insert(std::string_view const subject) {
+    size_t const hash = std::hash<std::string_view>{}(subject);
+
+    std::lock_guard<std::mutex> lock {mutex_};
+
+    table const* t = table_.load(std::memory_order_relaxed);
+    if (entry const* const e = probe(*t, subject, hash).load(std::memory_order_relaxed))
+        return e->id;
+
+    auto const id = topic_subject_id_for(subject);
+    if (auto it = ids_.find(id); it != ids_.end()) {
+        collisions_.push_back("subject [" + std::string(subject) + "] collides with ["
+                + it->second->subject + "] - ID " + std::to_string(id));
+        return 0;
+    }
+
+    auto const size = size_.load(std::memory_order_relaxed) + 1;
+
+    if (2 * size > t->mask + 1) {
+        // readers keep probing the old table until the new one is published
+        auto grown = std::make_unique<table>(2 * (t->mask + 1));
+        for (size_t i = 0; i <= t->mask; ++i)
+            if (entry const* const e = t->slots[i].load(std::memory_order_relaxed))
+                probe(*grown, e->subject, e->hash).store(e, std::memory_order_relaxed);
+
+        tables_.push_back(std::move(grown));
+        t = tables_.back().get();
+        table_.store(t, std::memory_order_release);
+    }
+
+    entries_.push_back(entry {std::string(subject), hash, id});
+    ids_.emplace(id, &entries_.back());
+    probe(*t, subject, hash).store(&entries_.back(), std::memory_order_release);
+    size_.store(size, std::memory_order_release);
+
+    return id;
+}
+
+std::vector<std::string> topic_subject_interner::collisions() const {
+    std::lock_guard<std::mutex> lock {mutex_};
+    return collisions_;
 }
 
 } // namespace ufw
@@ -11,60 +11,232 @@
 #include <typeinfo>
 #include <limits>
 #include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <stdexcept>
-#include <map>
+#include <unordered_map>
+#include <vector>
 
 namespace ufw {
 
 using topic_payload_id_t = uint32_t;
 using topic_subject_id_t = uint32_t;
+
+/*
+ * Topic IDs are hashes - the payload type name hash in the high word and the subject
+ * hash in the low word. Same subject and payload type give the same ID whether it is
+ * computed at compile time (topic<T, "subject">) or at run time (topic_id_for<T>()),
+ * hash collisions are detected when subjects and payload types get registered.
+ *
+ * The 32 bit subject hash limits a process to some thousands of subjects - the odds of
+ * a collision are about 1% at 9'300 subjects and 10% at 30'000, a collision is fatal
+ * at registration rather than silent.
+ */
 using topic_id_t = uint64_t;
 
-extern topic_payload_id_t next_topic_payload_id();
+constexpr uint32_t fnv1a_32(std::string_view const s) noexcept {
+    uint32_t h = UINT32_C(2166136261);
+    for (char const c: s) {
+        h ^= uint32_t(static_cast<unsigned char>(c));
+        h *= UINT32_C(16777619);
+    }
+    return h;
+}
+
+/*
+ * Portable payload type name, specialized with UFW_TOPIC_PAYLOAD(type, "name") for the
+ * payload types which must get the same ID from all the compilers, at the global namespace
+ * scope, e.g.
+ *
+ *     UFW_TOPIC_PAYLOAD(md::quote, "md.quote");
+ */
+template <typename T>
+struct topic_payload_traits {};
+
+#define UFW_TOPIC_PAYLOAD(type, payload_name) \
+    template <> struct ufw::topic_payload_traits<type> { static constexpr std::string_view name = payload_name; }
+
+// the registered name, otherwise compiler specific, but stable for a given compiler and unique per type
+template <typename T> constexpr
+std::string_view topic_payload_name() noexcept {
+    if constexpr (requires { topic_payload_traits<T>::name; })
+        return topic_payload_traits<T>::name;
+    else
+        return __PRETTY_FUNCTION__;
+}
+
+template <typename T> constexpr
+topic_payload_id_t topic_payload_id_for() noexcept {
+    return fnv1a_32(topic_payload_name<T>());
+}
+
+// never zero, so is a topic ID
+constexpr topic_subject_id_t topic_subject_id_for(std::string_view const subject) noexcept {
+    topic_subject_id_t const h = fnv1a_32(subject);
+    return h ? h : 1;
+}
+
+constexpr topic_id_t make_topic_id(topic_payload_id_t const payload_id, topic_subject_id_t const subject_id) noexcept {
+    return (topic_id_t(payload_id) << (8 * sizeof(topic_subject_id_t))) | subject_id;
+}
+
+/**
+ * Subject interner with lock-free lookups and serialized inserts.
+ *
+ * Readers probe an open-addressing table of atomic entry pointers published through
+ * an atomic pointer. Writers take a mutex and either fill an empty slot in place
+ * or, past half load, publish a doubled copy of the table (RCU style). Entries and
+ * retired tables live as long as the interner, so readers never see a dangling pointer.
+ */
+struct topic_subject_interner
+{
+    topic_subject_interner();
+    ~topic_subject_interner();
+
+    topic_subject_interner(topic_subject_interner const&) = delete;
+    topic_subject_interner& operator=(topic_subject_interner const&) = delete;
+
+    // lock-free, zero if the subject is not interned yet
+    topic_subject_id_t find(std::string_view subject) const noexcept;
+
+    // serialized, returns the subject ID, or zero if it collides with another
+    // subject, the collision is recorded then
+    topic_subject_id_t insert(std::string_view subject);
+
+    size_t size() const noexcept { return size_.load(std::memory_order_acquire); }
+
+    // descriptions of the collisions recorded so far
+    std::vector<std::string> collisions() const;
+
+private:
+    struct entry
+    {
+        std::string subject;
+        size_t hash;
+        topic_subject_id_t id;
+    };
+
+    struct table
+    {
+        explicit table(size_t capacity);
+
+        size_t const mask;
+        std::unique_ptr<std::atomic<entry const*>[]> const slots;
+    };
+
+    static std::atomic<entry const*>& probe(table const& t, std::string_view subject, size_t hash) noexcept;
+
+    std::atomic<table const*> table_;
+    std::atomic<size_t> size_ {0};
+
+    mutable std::mutex mutex_; // writers only
+    std::deque<entry> entries_;
+    std::vector<std::unique_ptr<table>> tables_; // current and retired
+    std::unordered_map<topic_subject_id_t, entry const*> ids_;
+    std::vector<std::string> collisions_;
+};
+
+// process-wide subject interner, shared by the compile time and the run time topics
+extern topic_subject_interner& topic_subjects();
+
+// returns the name of the payload type already registered with the same ID, empty if none
+extern std::string register_topic_payload(topic_payload_id_t id, std::string_view name, std::string const& pretty_name);
+
+// startup check - throws fatal_error describing all payload and subject hash collisions seen so far
+extern void verify_topic_ids();
 
 template <typename T> inline
-topic_payload_id_t verified_topic_payload_id(topic_payload_id_t const topic_payload_id) {
-    if (topic_payload_id == std::numeric_limits<topic_payload_id_t>::max()) {
+topic_payload_id_t verified_topic_payload_id() {
+    constexpr topic_payload_id_t topic_payload_id = topic_payload_id_for<T>();
+
+    auto const collision = register_topic_payload(topic_payload_id, topic_payload_name<T>(),
+            boost::core::demangle(typeid(T).name()));
+    if (!collision.empty()) {
         throw ufw::fatal_error("cound not register payload type ["
                 + boost::core::demangle(typeid(T).name())
-                +"] - too many payload types ("
+                +"] - payload ID "
                 + std::to_string(topic_payload_id)
-                + ") already registered");
+                + " is already taken by ["
+                + collision
+                + "]");
     }
 
     return topic_payload_id;
 }
 
-using topic_subject_interner_t = std::map<std::string, topic_subject_id_t>;
-
 template <typename T> inline
-topic_subject_id_t verified_topic_subject_id(std::string const& subject, topic_subject_interner_t& interner) {
-    auto const next_topic_subject_id = interner.size() + 1;
-    auto const status = interner.try_emplace(subject, next_topic_subject_id);
-    if (status.second && next_topic_subject_id == std::numeric_limits<topic_subject_id_t>::max()) {
+topic_subject_id_t verified_topic_subject_id(std::string_view const subject, topic_subject_interner& interner) {
+    auto const topic_subject_id = interner.insert(subject);
+    if (!topic_subject_id) {
         throw ufw::fatal_error("cound not register subject ["
-                + subject
+                + std::string(subject)
                 + "] for payload type ["
                 + boost::core::demangle(typeid(T).name())
-                +"] - maximum number topic subjects ("
-                + std::to_string(next_topic_subject_id)
-                + ") already registered for the payload type");
+                +"] - subject ID "
+                + std::to_string(topic_subject_id_for(subject))
+                + " collides with another subject");
     }
 
-    return status.first->second;
+    return topic_subject_id;
 }
 
 template <typename T> inline
-topic_id_t topic_id_for(std::string const& subject) {
-    static topic_payload_id_t const topic_payload_id
-            = verified_topic_payload_id<T>(next_topic_payload_id());
+topic_id_t topic_id_for(std::string_view const subject) {
+    static topic_payload_id_t const topic_payload_id = verified_topic_payload_id<T>();
 
-    static std::map<std::string, topic_subject_id_t> interner;
+    auto& interner = topic_subjects();
 
-    auto const topic_subject_id = verified_topic_subject_id<T>(subject, interner);
+    auto topic_subject_id = interner.find(subject);
+    if (!topic_subject_id)
+        topic_subject_id = verified_topic_subject_id<T>(subject, interner);
 
-    return (topic_payload_id << sizeof(topic_payload_id)) + topic_subject_id;
+    return make_topic_id(topic_payload_id, topic_subject_id);
 }
 
+template <size_t N>
+struct topic_subject_literal
+{
+    constexpr topic_subject_literal(char const (&s)[N]) noexcept {
+        for (size_t i = 0; i < N; ++i) value[i] = s[i];
+    }
+
+    constexpr std::string_view view() const noexcept { return {value, N - 1}; }
+
+    char value[N];
+};
+
+// called during static initialization, never throws, collisions are reported by verify_topic_ids()
+extern bool register_static_topic(std::string_view subject, topic_payload_id_t payload_id,
+        std::string_view payload_name, std::string const& pretty_name) noexcept;
+
+/**
+ * Compile time topic for a literal subject, e.g.
+ *
+ *     topics.publish(topic<quote, "md.quotes">::id, q);
+ *
+ * The ID costs nothing at run time, the subject gets registered with the interner
+ * during static initialization so that collisions with the run time subjects are
+ * caught by verify_topic_ids().
+ */
+template <typename T, topic_subject_literal Subject>
+struct topic
+{
+    using payload_type = T;
+
+    static constexpr std::string_view subject = Subject.view();
+
+private:
+    static inline bool const registered_ = register_static_topic(Subject.view(),
+            topic_payload_id_for<T>(), topic_payload_name<T>(), boost::core::demangle(typeid(T).name()));
+
+public:
+    // taking the address instantiates the registration
+    static constexpr topic_id_t id = (static_cast<void>(&registered_),
+            make_topic_id(topic_payload_id_for<T>(), topic_subject_id_for(Subject.view())));
+};
+
 } // namespace ufw